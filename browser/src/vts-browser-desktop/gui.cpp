@@ -1118,6 +1118,9 @@ public:
                 S("Node draw updates:", cs.currentNodeDrawsUpdates, "");
                 S("Preparing:", ms.resourcesPreparing, "");
                 S("Downloading:", ms.resourcesDownloading, "");
+                S("Downloads limit:", ms.currentDownloadsLimit, "");
+                S("Latency:", ms.currentDownloadLatencyMs, " ms");
+                S("Throughput:", ms.currentDownloadThroughputKBps, " KB/s");
 
                 if (nk_tree_push(&ctx, NK_TREE_TAB, "Queues",
                     NK_MINIMIZED))
@@ -1135,6 +1138,21 @@ public:
                     nk_tree_pop(&ctx);
                 }
 
+                if (nk_tree_push(&ctx, NK_TREE_TAB, "Memory",
+                    NK_MINIMIZED))
+                {
+                    float ratio2[] = { width * 0.45f, width * 0.45f };
+                    nk_layout_row(&ctx, NK_STATIC, 16, 2, ratio2);
+
+                    S("Textures:", ms.currentTexturesMemUseKB / 1024, " MB");
+                    S("Meshes:", ms.currentMeshesMemUseKB / 1024, " MB");
+                    S("Metatiles:", ms.currentMetatilesMemUseKB / 1024, " MB");
+                    S("Geodata:", ms.currentGeodataMemUseKB / 1024, " MB");
+                    S("Fonts:", ms.currentFontsMemUseKB / 1024, " MB");
+
+                    nk_tree_pop(&ctx);
+                }
+
                 if (nk_tree_push(&ctx, NK_TREE_TAB, "Total",
                     NK_MINIMIZED))
                 {
@@ -1143,7 +1161,9 @@ public:
 
                     S("Active:", ms.resourcesActive, "");
                     S("Downloaded:", ms.resourcesDownloaded, "");
+                    S("Cancelled:", ms.resourcesCancelled, "");
                     S("Disk loaded:", ms.resourcesDiskLoaded, "");
+                    S("Revalidated:", ms.resourcesRevalidated, "");
                     S("Decoded:", ms.resourcesDecoded, "");
                     S("Uploaded:", ms.resourcesUploaded, "");
                     S("Created:", ms.resourcesCreated, "");
@@ -0,0 +1,150 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <vts-browser/foundation.hpp>
+#include "../vts-libbrowser/utilities/threadQueue.hpp"
+
+#include <boost/program_options.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+// compares the thread queues used in the resources pipeline
+//   under synthetic producer/consumer load
+
+namespace po = boost::program_options;
+
+namespace
+{
+
+struct Config
+{
+    uint32 producers = 4;
+    uint32 consumers = 3;
+    uint32 items = 1000000;
+};
+
+// producers push all items, consumers pop until all items are received
+template<class Push, class Pop, class Stop>
+double run(const Config &cfg, Push push, Pop pop, Stop stop)
+{
+    std::atomic<uint64> received(0);
+    std::vector<std::thread> thrs;
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32 c = 0; c < cfg.consumers; c++)
+    {
+        thrs.push_back(std::thread([&]() {
+            uint64 v;
+            while (pop(v))
+            {
+                if (++received == cfg.items)
+                    stop();
+            }
+        }));
+    }
+    for (uint32 p = 0; p < cfg.producers; p++)
+    {
+        thrs.push_back(std::thread([&, p]() {
+            for (uint32 i = p; i < cfg.items; i += cfg.producers)
+                push(i);
+        }));
+    }
+    for (std::thread &t : thrs)
+        t.join();
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+void report(const std::string &name, const Config &cfg, double seconds)
+{
+    std::cout << std::left << std::setw(24) << name
+        << std::right << std::setw(10) << std::fixed << std::setprecision(3)
+        << seconds << " s" << std::setw(14) << std::setprecision(0)
+        << cfg.items / seconds << " items/s" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    Config cfg;
+    po::options_description desc("Options");
+    desc.add_options()
+            ("help", "Show this help.")
+            ("producers",
+                po::value<uint32>(&cfg.producers)
+                ->default_value(cfg.producers),
+                "Number of producer threads."
+            )
+            ("consumers",
+                po::value<uint32>(&cfg.consumers)
+                ->default_value(cfg.consumers),
+                "Number of consumer threads."
+            )
+            ("items",
+                po::value<uint32>(&cfg.items)
+                ->default_value(cfg.items),
+                "Total number of items passed through the queue."
+            )
+            ;
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    if (vm.count("help"))
+    {
+        std::cout << desc << std::endl;
+        return 0;
+    }
+    po::notify(vm);
+    if (cfg.producers == 0 || cfg.consumers == 0 || cfg.items == 0)
+    {
+        std::cerr << "Producers, consumers and items must be positive"
+            << std::endl;
+        return 1;
+    }
+
+    std::cout << cfg.producers << " producers, "
+        << cfg.consumers << " consumers, "
+        << cfg.items << " items" << std::endl;
+
+    {
+        vts::ThreadQueue<uint64> q;
+        report("ThreadQueue", cfg, run(cfg,
+            [&](uint64 v) { q.push(v); },
+            [&](uint64 &v) { return q.waitPop(v); },
+            [&]() { q.terminate(); }));
+    }
+
+    {
+        vts::ThreadQueuePriority<uint64> q;
+        report("ThreadQueuePriority", cfg, run(cfg,
+            [&](uint64 v) { q.push(std::move(v), (float)(v % 100)); },
+            [&](uint64 &v) { return q.waitPop(v); },
+            [&]() { q.terminate(); }));
+    }
+
+    return 0;
+}
@@ -0,0 +1,208 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <vts-browser/map.hpp>
+#include <vts-browser/mapOptions.hpp>
+#include <vts-browser/fetcher.hpp>
+#include <vts-browser/seeding.hpp>
+#include <vts-browser/log.hpp>
+#include <vts-browser/boostProgramOptions.hpp>
+
+#include <thread>
+#include <chrono>
+#include <iostream>
+
+namespace po = boost::program_options;
+
+namespace
+{
+
+bool programOptions(vts::MapCreateOptions &createOptions,
+                    vts::MapRuntimeOptions &mapOptions,
+                    vts::FetcherOptions &fetcherOptions,
+                    vts::SeedingOptions &seedOptions,
+                    std::string &mapconfig, std::string &auth,
+                    int argc, char *argv[])
+{
+    std::vector<double> extents;
+
+    po::options_description desc("Options");
+    desc.add_options()
+            ("help", "Show this help.")
+            ("url",
+                po::value<std::string>(&mapconfig)->required(),
+                "Mapconfig URL."
+            )
+            ("auth,a",
+                po::value<std::string>(&auth),
+                "Authentication url."
+            )
+            ("extents",
+                po::value<std::vector<double>>(&extents)->multitoken(),
+                "Region to download, in navigation srs.\n"
+                "Format: <low x> <low y> <high x> <high y>"
+            )
+            ("lodMin",
+                po::value<uint32>(&seedOptions.lodMin)
+                ->default_value(seedOptions.lodMin),
+                "Lowest level of detail to download."
+            )
+            ("lodMax",
+                po::value<uint32>(&seedOptions.lodMax)
+                ->default_value(seedOptions.lodMax),
+                "Highest level of detail to download."
+            )
+            ("concurrentDownloads",
+                po::value<uint32>(&seedOptions.maxConcurrentDownloads)
+                ->default_value(seedOptions.maxConcurrentDownloads),
+                "Maximum number of downloads at the same time."
+            )
+            ("boundLayers",
+                po::value<bool>(&seedOptions.boundLayers)
+                ->default_value(seedOptions.boundLayers)
+                ->implicit_value(!seedOptions.boundLayers),
+                "Download textures of bound layers."
+            )
+            ("freeLayers",
+                po::value<bool>(&seedOptions.freeLayers)
+                ->default_value(seedOptions.freeLayers)
+                ->implicit_value(!seedOptions.freeLayers),
+                "Download free layers."
+            )
+            ;
+
+    po::positional_options_description popts;
+    popts.add("url", 1);
+
+    vts::optionsConfigLog(desc);
+    vts::optionsConfigMapCreate(desc, &createOptions);
+    vts::optionsConfigMapRuntime(desc, &mapOptions);
+    vts::optionsConfigFetcherOptions(desc, &fetcherOptions);
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).
+          options(desc).positional(popts).run(), vm);
+
+    if (vm.count("help"))
+    {
+        std::cout << "Usage: " << argv[0] << " [options] [--]"
+                  << " url"
+                  << std::endl << desc << std::endl;
+        return false;
+    }
+
+    po::notify(vm);
+
+    if (!extents.empty())
+    {
+        if (extents.size() != 4)
+            throw std::runtime_error("Extents must have four values.");
+        seedOptions.extentsLow[0] = extents[0];
+        seedOptions.extentsLow[1] = extents[1];
+        seedOptions.extentsHigh[0] = extents[2];
+        seedOptions.extentsHigh[1] = extents[3];
+    }
+    if (seedOptions.lodMin > seedOptions.lodMax)
+        throw std::runtime_error("Invalid range of lods.");
+
+    return true;
+}
+
+void printProgress(const vts::SeedingTask &task)
+{
+    std::cout << "nodes: " << task.nodesVisited
+        << " (pending " << task.nodesPending << ")"
+        << ", downloads: " << task.downloadsDone
+        << " (active " << task.downloadsActive
+        << ", queued " << task.downloadsQueued
+        << ", cached " << task.downloadsCached
+        << ", failed " << task.downloadsFailed << ")"
+        << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        vts::setLogThreadName("main");
+
+        vts::MapCreateOptions createOptions;
+        createOptions.clientId = "vts-browser-seed";
+        vts::MapRuntimeOptions mapOptions;
+        vts::FetcherOptions fetcherOptions;
+        vts::SeedingOptions seedOptions;
+        std::string mapconfig, auth;
+        if (!programOptions(createOptions, mapOptions, fetcherOptions,
+                            seedOptions, mapconfig, auth, argc, argv))
+            return 0;
+        if (!createOptions.diskCache)
+            throw std::runtime_error("Seeding requires the disk cache.");
+
+        auto map = std::make_shared<vts::Map>(createOptions,
+            vts::Fetcher::create(fetcherOptions));
+        map->options() = mapOptions;
+        map->setMapconfigPath(mapconfig, auth);
+
+        // no camera is needed, the map is updated until the task is done
+        //   the data are processed on this thread too
+        std::shared_ptr<vts::SeedingTask> task;
+        auto last = std::chrono::steady_clock::now();
+        auto lastPrint = last;
+        while (!task || !task->done)
+        {
+            auto now = std::chrono::steady_clock::now();
+            map->renderUpdate(
+                std::chrono::duration<double>(now - last).count());
+            last = now;
+            map->dataUpdate();
+            if (!task && map->getMapconfigReady())
+                task = map->seed(seedOptions);
+            if (task && now - lastPrint > std::chrono::seconds(1))
+            {
+                printProgress(*task);
+                lastPrint = now;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        printProgress(*task);
+
+        map->renderFinalize();
+        map->dataFinalize();
+        return task->downloadsFailed > 0 ? 2 : 0;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        return 1;
+    }
+    catch (...)
+    {
+        std::cerr << "Unknown exception." << std::endl;
+        return 1;
+    }
+}
@@ -253,6 +253,9 @@ public static extern void vtsMapGetDefaultPosition(IntPtr map, IntPtr position);
 [DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
 public static extern void vtsMapDataUpdate(IntPtr map);
 
+[DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
+public static extern void vtsMapDataUpdateBudget(IntPtr map, double budgetMs);
+
 [DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
 public static extern void vtsMapDataAllRun(IntPtr map);
 
@@ -132,6 +132,12 @@ namespace vts
             Util.CheckInterop();
         }
 
+        public void DataUpdate(double budgetMs)
+        {
+            BrowserInterop.vtsMapDataUpdateBudget(Handle, budgetMs);
+            Util.CheckInterop();
+        }
+
         public void DataFinalize()
         {
             BrowserInterop.vtsMapDataFinalize(Handle);
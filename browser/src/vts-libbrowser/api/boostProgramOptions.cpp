@@ -107,11 +107,34 @@ void optionsConfigMapCreate(
         po::value<std::string>(&opts->cachePath),
         "Path to a directory where all downloaded resources are cached.")
 
+    ((section + "decodeThreads").c_str(),
+        po::value<uint32>(&opts->decodeThreads),
+        "Number of threads used for decoding resources, "
+        "0 = deduce from hardware concurrency.")
+
+    ((section + "cacheReadThreads").c_str(),
+        po::value<uint32>(&opts->cacheReadThreads),
+        "Number of threads reading resources from disk cache.")
+
     ((section + "diskCache").c_str(),
         po::value<bool>(&opts->diskCache)
         ->implicit_value(!opts->diskCache),
         "Use disk cache.")
 
+    ((section + "diskCachePacked").c_str(),
+        po::value<bool>(&opts->diskCachePacked)
+        ->implicit_value(!opts->diskCachePacked),
+        "Store disk cache in large memory mapped segment files.")
+
+    ((section + "diskCacheMaxSizeMB").c_str(),
+        po::value<uint32>(&opts->diskCacheMaxSizeMB),
+        "Maximum size of the disk cache, zero for unlimited.")
+
+    ((section + "diskCacheCompression").c_str(),
+        po::value<bool>(&opts->diskCacheCompression)
+        ->implicit_value(!opts->diskCacheCompression),
+        "Compress suitable resources in disk cache.")
+
     FILE_OPTIONS;
 }
 
@@ -133,10 +156,51 @@ void optionsConfigMapRuntime(
         "Target memory (in KB) used by resources "
         "before they begin to unload.")
 
+    ((section + "targetResourcesRamKB").c_str(),
+        po::value<uint32>(&opts->targetResourcesRamKB),
+        "Target RAM (in KB) used by resources "
+        "before they begin to unload. Zero to disable.")
+
+    ((section + "targetResourcesGpuKB").c_str(),
+        po::value<uint32>(&opts->targetResourcesGpuKB),
+        "Maximum GPU memory (in KB) used by resources. "
+        "Even recently used resources are unloaded to keep this limit. "
+        "Zero to disable.")
+
+    ((section + "targetTexturesMemoryKB").c_str(),
+        po::value<uint32>(&opts->targetTexturesMemoryKB),
+        "Target memory (in KB) used by textures. Zero to disable.")
+
+    ((section + "targetMeshesMemoryKB").c_str(),
+        po::value<uint32>(&opts->targetMeshesMemoryKB),
+        "Target memory (in KB) used by meshes. Zero to disable.")
+
+    ((section + "targetMetatilesMemoryKB").c_str(),
+        po::value<uint32>(&opts->targetMetatilesMemoryKB),
+        "Target memory (in KB) used by metatiles. Zero to disable.")
+
+    ((section + "targetGeodataMemoryKB").c_str(),
+        po::value<uint32>(&opts->targetGeodataMemoryKB),
+        "Target memory (in KB) used by geodata. Zero to disable.")
+
+    ((section + "targetFontsMemoryKB").c_str(),
+        po::value<uint32>(&opts->targetFontsMemoryKB),
+        "Target memory (in KB) used by fonts. Zero to disable.")
+
     ((section + "maxConcurrentDownloads").c_str(),
         po::value<uint32>(&opts->maxConcurrentDownloads),
         "Maximum size of the queue for the resources to be downloaded.")
 
+    ((section + "adaptiveConcurrentDownloads").c_str(),
+        po::value<bool>(&opts->adaptiveConcurrentDownloads)
+        ->implicit_value(!opts->adaptiveConcurrentDownloads),
+        "Adapt the number of concurrent downloads "
+        "to the observed latency and throughput.")
+
+    ((section + "minConcurrentDownloads").c_str(),
+        po::value<uint32>(&opts->minConcurrentDownloads),
+        "Minimum number of concurrent downloads when adaptive.")
+
     ((section + "maxFetchRedirections").c_str(),
         po::value<uint32>(&opts->maxFetchRedirections),
         "Maximum number of redirections before the download fails.")
@@ -149,6 +213,25 @@ void optionsConfigMapRuntime(
         po::value<uint32>(&opts->fetchFirstRetryTimeOffset),
         "Delay in seconds for first resource download retry.")
 
+    ((section + "textureCompressionSurfaces").c_str(),
+        po::value<TextureCompression>(&opts->textureCompressionSurfaces),
+        "Compress internal textures of surfaces on the decode threads:\n"
+        "none\n"
+        "bc\n"
+        "etc2")
+
+    ((section + "textureCompressionBoundLayers").c_str(),
+        po::value<TextureCompression>(&opts->textureCompressionBoundLayers),
+        "Compress textures of bound layers on the decode threads:\n"
+        "none\n"
+        "bc\n"
+        "etc2")
+
+    ((section + "textureMipmapsOnDecode").c_str(),
+        po::value<bool>(&opts->textureMipmapsOnDecode)
+        ->implicit_value(!opts->textureMipmapsOnDecode),
+        "Generate mipmaps of textures on the decode threads.")
+
     ((section + "debugSaveCorruptedFiles").c_str(),
         po::value<bool>(&opts->debugSaveCorruptedFiles)
         ->implicit_value(!opts->debugSaveCorruptedFiles),
@@ -273,6 +356,30 @@ void optionsConfigFetcherOptions(
         ->implicit_value(!opts->extraFileLog),
         "Produce separate log with downloads.")
 
+    ((section + "recordPath").c_str(),
+        po::value<std::string>(&opts->recordPath),
+        "Store all downloads into the directory for later replay.")
+
+    ((section + "replayPath").c_str(),
+        po::value<std::string>(&opts->replayPath),
+        "Serve all downloads from previously recorded directory.")
+
+    ((section + "replayLatencyScale").c_str(),
+        po::value<double>(&opts->replayLatencyScale),
+        "Multiplier of recorded latencies during replay.")
+
+    ((section + "replayLatencyExtra").c_str(),
+        po::value<uint32>(&opts->replayLatencyExtra),
+        "Latency added to each download during replay (ms).")
+
+    ((section + "replayLatencyJitter").c_str(),
+        po::value<uint32>(&opts->replayLatencyJitter),
+        "Maximum random latency added during replay (ms).")
+
+    ((section + "replayBandwidth").c_str(),
+        po::value<uint32>(&opts->replayBandwidth),
+        "Simulated bandwidth during replay (bytes per second).")
+
     FILE_OPTIONS;
 }
 
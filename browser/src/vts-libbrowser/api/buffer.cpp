@@ -36,6 +36,7 @@
 #include <dbglog/dbglog.hpp>
 
 #include <cstring>
+#include <algorithm>
 #include <map>
 
 void initializeBrowserData();
@@ -101,12 +102,27 @@ Buffer::Buffer(const std::string &str) : data_(nullptr), size_(0)
     memcpy(data_, str.data(), size_);
 }
 
+Buffer::Buffer(std::string &&str) : data_(nullptr), size_(0)
+{
+    if (str.empty())
+        return;
+    auto s = std::make_shared<std::string>(std::move(str));
+    data_ = &(*s)[0];
+    size_ = s->size();
+    owner_ = std::move(s);
+}
+
+Buffer::Buffer(char *data, uint32 size, std::shared_ptr<void> owner) :
+    owner_(std::move(owner)), data_(data), size_(size)
+{}
+
 Buffer::~Buffer()
 {
     this->free();
 }
 
-Buffer::Buffer(Buffer &&other) noexcept : data_(other.data_), size_(other.size_)
+Buffer::Buffer(Buffer &&other) noexcept : owner_(std::move(other.owner_)),
+    data_(other.data_), size_(other.size_)
 {
     other.data_ = nullptr;
     other.size_ = 0;
@@ -116,6 +132,7 @@ Buffer &Buffer::operator = (Buffer &&other) noexcept
 {
     assert(&other != this);
     this->free();
+    owner_ = std::move(other.owner_);
     size_ = other.size_;
     data_ = other.data_;
     other.data_ = nullptr;
@@ -130,6 +147,21 @@ Buffer Buffer::copy() const
     return r;
 }
 
+Buffer Buffer::share()
+{
+    return view(0, size_);
+}
+
+Buffer Buffer::view(uint32 offset, uint32 size)
+{
+    assert(offset + size <= size_);
+    if (!data_)
+        return Buffer();
+    if (!owner_)
+        owner_ = std::shared_ptr<void>(data_, ::free);
+    return Buffer(data_ + offset, size, owner_);
+}
+
 std::string Buffer::str() const
 {
     return std::string(data_, size_);
@@ -148,6 +180,14 @@ void Buffer::allocate(uint32 size)
 
 void Buffer::resize(uint32 size)
 {
+    if (owner_)
+    {
+        // the storage may not be reallocated in place
+        Buffer tmp(size);
+        memcpy(tmp.data_, data_, std::min(size, size_));
+        *this = std::move(tmp);
+        return;
+    }
     char *tmp = (char*)realloc(data_, size);
     if (!tmp)
     {
@@ -166,35 +206,18 @@ void Buffer::zero()
 
 void Buffer::free()
 {
-    ::free(data_);
+    if (owner_)
+        owner_.reset();
+    else
+        ::free(data_);
     data_ = nullptr;
     size_ = 0;
 }
 
 void writeLocalFileBuffer(const std::string &path, const Buffer &buffer)
 {
-    std::string folderPath = boost::filesystem::path(path)
-            .parent_path().string();
-    if (!folderPath.empty())
-        boost::filesystem::create_directories(folderPath);
-    std::string tmpPath = path + "_tmp_" + uniqueName();
-    FILE *f = fopen(tmpPath.c_str(), "wb");
-    if (!f)
-        LOGTHROW(err1, std::runtime_error) << "Failed to write file <"
-                                           << path << ">";
-    if (buffer.size() > 0)
-    {
-        if (fwrite(buffer.data(), buffer.size(), 1, f) != 1)
-        {
-            fclose(f);
-            LOGTHROW(err1, std::runtime_error) << "Failed to write file <"
-                                               << path << ">";
-        }
-    }
-    if (fclose(f) != 0)
-        LOGTHROW(err1, std::runtime_error) << "Failed to write file <"
-                                           << path << ">";
-    boost::filesystem::rename(tmpPath, path);
+    const Buffer *b = &buffer;
+    detail::writeLocalFileBuffers(path, &b, 1);
 }
 
 Buffer readLocalFileBuffer(const std::string &path)
@@ -235,6 +258,35 @@ Buffer readInternalMemoryBuffer(const std::string &path)
 namespace detail
 {
 
+void writeLocalFileBuffers(const std::string &path,
+    const Buffer *const *buffers, uint32 count)
+{
+    std::string folderPath = boost::filesystem::path(path)
+            .parent_path().string();
+    if (!folderPath.empty())
+        boost::filesystem::create_directories(folderPath);
+    std::string tmpPath = path + "_tmp_" + uniqueName();
+    FILE *f = fopen(tmpPath.c_str(), "wb");
+    if (!f)
+        LOGTHROW(err1, std::runtime_error) << "Failed to write file <"
+                                           << path << ">";
+    for (uint32 i = 0; i < count; i++)
+    {
+        const Buffer &buffer = *buffers[i];
+        if (buffer.size() > 0
+            && fwrite(buffer.data(), buffer.size(), 1, f) != 1)
+        {
+            fclose(f);
+            LOGTHROW(err1, std::runtime_error) << "Failed to write file <"
+                                               << path << ">";
+        }
+    }
+    if (fclose(f) != 0)
+        LOGTHROW(err1, std::runtime_error) << "Failed to write file <"
+                                           << path << ">";
+    boost::filesystem::rename(tmpPath, path);
+}
+
 BufferStream::BufferStream(const Buffer &b) : std::istream(this)
 {
     setg(b.data(), b.data(), b.data() + b.size());
@@ -400,6 +400,13 @@ void vtsMapDataUpdate(vtsHMap map)
     C_END
 }
 
+void vtsMapDataUpdateBudget(vtsHMap map, double budgetMs)
+{
+    C_BEGIN
+    map->p->dataUpdate(budgetMs);
+    C_END
+}
+
 void vtsMapDataAllRun(vtsHMap map)
 {
     C_BEGIN
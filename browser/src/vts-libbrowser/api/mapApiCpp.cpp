@@ -28,6 +28,7 @@
 #include "../include/vts-browser/view.hpp"
 #include "../utilities/json.hpp"
 #include "../map.hpp"
+#include "../sharedContext.hpp"
 #include "../mapConfig.hpp"
 #include "../gpuResource.hpp"
 #include "../renderInfos.hpp"
@@ -132,10 +133,16 @@ Map::Map(const MapCreateOptions &options) :
 {}
 
 Map::Map(const MapCreateOptions &options,
-    const std::shared_ptr<Fetcher> &fetcher)
+    const std::shared_ptr<Fetcher> &fetcher) :
+    Map(options, MapSharedContext::create(options, fetcher))
+{}
+
+Map::Map(const MapCreateOptions &options,
+    const std::shared_ptr<MapSharedContext> &context)
 {
     LOG(info3) << "Creating map";
-    impl = std::make_shared<MapImpl>(this, options, fetcher);
+    impl = std::make_shared<MapImpl>(this, options,
+        std::dynamic_pointer_cast<MapSharedContextImpl>(context));
 }
 
 Map::~Map()
@@ -217,7 +224,12 @@ double Map::getMapRenderProgress() const
 
 void Map::dataUpdate()
 {
-    impl->resourcesDataUpdate();
+    impl->resourcesDataUpdate(0);
+}
+
+void Map::dataUpdate(double budgetMs)
+{
+    impl->resourcesDataUpdate(budgetMs);
 }
 
 void Map::dataAllRun()
@@ -567,4 +579,11 @@ std::shared_ptr<SearchTask> Map::search(const std::string &query,
     return search(query, point.data());
 }
 
+std::shared_ptr<SeedingTask> Map::seed(const SeedingOptions &options)
+{
+    if (!getMapconfigReady())
+        return {};
+    return impl->seed(options);
+}
+
 } // namespace vts
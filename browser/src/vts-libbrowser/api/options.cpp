@@ -66,8 +66,13 @@ void MapCreateOptions::applyJson(const std::string &json)
     AJ(searchSrsFallback, asString);
     AJ(customSrs1, asString);
     AJ(customSrs2, asString);
+    AJ(decodeThreads, asUInt);
+    AJ(cacheReadThreads, asUInt);
     AJ(diskCache, asBool);
     AJ(hashCachePaths, asBool);
+    AJ(diskCachePacked, asBool);
+    AJ(diskCacheMaxSizeMB, asUInt);
+    AJ(diskCacheCompression, asBool);
     AJ(searchUrlFallbackOutsideEarth, asBool);
     AJ(browserOptionsSearchUrls, asBool);
 }
@@ -82,8 +87,13 @@ std::string MapCreateOptions::toJson() const
     TJ(searchSrsFallback, asString);
     TJ(customSrs1, asString);
     TJ(customSrs2, asString);
+    TJ(decodeThreads, asUInt);
+    TJ(cacheReadThreads, asUInt);
     TJ(diskCache, asBool);
     TJ(hashCachePaths, asBool);
+    TJ(diskCachePacked, asBool);
+    TJ(diskCacheMaxSizeMB, asUInt);
+    TJ(diskCacheCompression, asBool);
     TJ(searchUrlFallbackOutsideEarth, asBool);
     TJ(browserOptionsSearchUrls, asBool);
     return jsonToString(v);
@@ -108,12 +118,25 @@ void MapRuntimeOptions::applyJson(const std::string &json)
     AJ(pixelsPerInch, asDouble);
     AJ(renderTilesScale, asDouble);
     AJ(targetResourcesMemoryKB, asUInt);
+    AJ(targetResourcesRamKB, asUInt);
+    AJ(targetResourcesGpuKB, asUInt);
+    AJ(targetTexturesMemoryKB, asUInt);
+    AJ(targetMeshesMemoryKB, asUInt);
+    AJ(targetMetatilesMemoryKB, asUInt);
+    AJ(targetGeodataMemoryKB, asUInt);
+    AJ(targetFontsMemoryKB, asUInt);
     AJ(maxConcurrentDownloads, asUInt);
+    AJ(adaptiveConcurrentDownloads, asBool);
+    AJ(minConcurrentDownloads, asUInt);
     AJ(maxCacheWriteQueueLength, asUInt);
     AJ(maxResourceProcessesPerTick, asUInt);
+    AJ(maxResourceUploadKBPerTick, asUInt);
     AJ(maxFetchRedirections, asUInt);
     AJ(maxFetchRetries, asUInt);
     AJ(fetchFirstRetryTimeOffset, asUInt);
+    AJE(textureCompressionSurfaces, TextureCompression);
+    AJE(textureCompressionBoundLayers, TextureCompression);
+    AJ(textureMipmapsOnDecode, asBool);
     AJ(measurementUnitsSystem, asUInt);
     AJ(debugVirtualSurfaces, asBool);
     AJ(debugSaveCorruptedFiles, asBool);
@@ -129,12 +152,25 @@ std::string MapRuntimeOptions::toJson() const
     TJ(pixelsPerInch, asDouble);
     TJ(renderTilesScale, asDouble);
     TJ(targetResourcesMemoryKB, asUInt);
+    TJ(targetResourcesRamKB, asUInt);
+    TJ(targetResourcesGpuKB, asUInt);
+    TJ(targetTexturesMemoryKB, asUInt);
+    TJ(targetMeshesMemoryKB, asUInt);
+    TJ(targetMetatilesMemoryKB, asUInt);
+    TJ(targetGeodataMemoryKB, asUInt);
+    TJ(targetFontsMemoryKB, asUInt);
     TJ(maxConcurrentDownloads, asUInt);
+    TJ(adaptiveConcurrentDownloads, asBool);
+    TJ(minConcurrentDownloads, asUInt);
     TJ(maxCacheWriteQueueLength, asUInt);
     TJ(maxResourceProcessesPerTick, asUInt);
+    TJ(maxResourceUploadKBPerTick, asUInt);
     TJ(maxFetchRedirections, asUInt);
     TJ(maxFetchRetries, asUInt);
     TJ(fetchFirstRetryTimeOffset, asUInt);
+    TJE(textureCompressionSurfaces, TextureCompression);
+    TJE(textureCompressionBoundLayers, TextureCompression);
+    TJ(textureMipmapsOnDecode, asBool);
     TJ(measurementUnitsSystem, asUInt);
     TJ(debugVirtualSurfaces, asBool);
     TJ(debugSaveCorruptedFiles, asBool);
@@ -320,6 +356,12 @@ void FetcherOptions::applyJson(const std::string &json)
     AJ(maxTotalConnections, asUInt);
     AJ(maxCacheConections, asUInt);
     AJ(pipelining, asUInt);
+    AJ(recordPath, asString);
+    AJ(replayPath, asString);
+    AJ(replayLatencyScale, asDouble);
+    AJ(replayLatencyExtra, asUInt);
+    AJ(replayLatencyJitter, asUInt);
+    AJ(replayBandwidth, asUInt);
 }
 
 std::string FetcherOptions::toJson() const
@@ -332,6 +374,12 @@ std::string FetcherOptions::toJson() const
     TJ(maxTotalConnections, asUInt);
     TJ(maxCacheConections, asUInt);
     TJ(pipelining, asUInt);
+    TJ(recordPath, asString);
+    TJ(replayPath, asString);
+    TJ(replayLatencyScale, asDouble);
+    TJ(replayLatencyExtra, asUInt);
+    TJ(replayLatencyJitter, asUInt);
+    TJ(replayBandwidth, asUInt);
     return jsonToString(v);
 }
 
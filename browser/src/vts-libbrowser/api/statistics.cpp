@@ -34,7 +34,9 @@ namespace vts
 MapStatistics::MapStatistics() :
     resourcesCreated(0),
     resourcesDownloaded(0),
+    resourcesCancelled(0),
     resourcesDiskLoaded(0),
+    resourcesRevalidated(0),
     resourcesDecoded(0),
     resourcesUploaded(0),
     resourcesFailed(0),
@@ -49,8 +51,16 @@ MapStatistics::MapStatistics() :
     resourcesQueueUpload(0),
     resourcesQueueGeodata(0),
     resourcesQueueAtmosphere(0),
+    currentDownloadsLimit(0),
+    currentDownloadLatencyMs(0),
+    currentDownloadThroughputKBps(0),
     currentGpuMemUseKB(0),
     currentRamMemUseKB(0),
+    currentTexturesMemUseKB(0),
+    currentMeshesMemUseKB(0),
+    currentMetatilesMemUseKB(0),
+    currentGeodataMemUseKB(0),
+    currentFontsMemUseKB(0),
     renderTicks(0)
 {}
 
@@ -59,7 +69,9 @@ std::string MapStatistics::toJson() const
     Json::Value v;
     TJ(resourcesCreated, asUint);
     TJ(resourcesDownloaded, asUint);
+    TJ(resourcesCancelled, asUint);
     TJ(resourcesDiskLoaded, asUint);
+    TJ(resourcesRevalidated, asUint);
     TJ(resourcesDecoded, asUint);
     TJ(resourcesUploaded, asUint);
     TJ(resourcesFailed, asUint);
@@ -74,8 +86,16 @@ std::string MapStatistics::toJson() const
     TJ(resourcesQueueUpload, asUint);
     TJ(resourcesQueueGeodata, asUint);
     TJ(resourcesQueueAtmosphere, asUint);
+    TJ(currentDownloadsLimit, asUint);
+    TJ(currentDownloadLatencyMs, asUint);
+    TJ(currentDownloadThroughputKBps, asUint);
     TJ(currentGpuMemUseKB, asUint);
     TJ(currentRamMemUseKB, asUint);
+    TJ(currentTexturesMemUseKB, asUint);
+    TJ(currentMeshesMemUseKB, asUint);
+    TJ(currentMetatilesMemUseKB, asUint);
+    TJ(currentGeodataMemUseKB, asUint);
+    TJ(currentFontsMemUseKB, asUint);
     TJ(renderTicks, asUint);
     return jsonToString(v);
 }
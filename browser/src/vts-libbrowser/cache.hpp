@@ -0,0 +1,73 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CACHE_HPP_kjh4g5f6d
+#define CACHE_HPP_kjh4g5f6d
+
+#include "map.hpp"
+
+namespace vts
+{
+
+// disk cache for downloaded resources
+// the methods may be called from multiple threads
+class Cache : private Immovable
+{
+public:
+    static std::shared_ptr<Cache> create(const MapCreateOptions &options);
+    virtual ~Cache();
+
+    virtual void write(CacheData &&data) = 0;
+    // expired entries are returned only if they have validators
+    //   (etag or last modified time) for conditional download
+    virtual CacheData read(const std::string &name) = 0;
+    virtual void purge() = 0;
+    // valid, not expired entry
+    // checks only the index and the entry header, without reading
+    //   the content
+    virtual bool contains(const std::string &name) = 0;
+
+    static bool expired(sint64 expires);
+
+protected:
+    static std::string stripScheme(const std::string &name);
+
+    // returns empty buffer if the compression does not pay off
+    static Buffer compress(const Buffer &raw);
+    static Buffer decompress(const Buffer &compressed);
+};
+
+// stores the entries in large append-only segment files
+//   with persistent index and reads them through memory mapping
+// when maxSize (in bytes) is exceeded, the oldest segment is collected:
+//   entries read since the last collection are moved to the newest segment,
+//   other entries are dropped
+std::shared_ptr<Cache> createPackedCache(const std::string &root,
+    uint64 maxSize);
+
+} // namespace vts
+
+#endif
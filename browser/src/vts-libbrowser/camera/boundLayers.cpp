@@ -141,9 +141,8 @@ Validity BoundParamInfo::prepareDepth(CameraImpl *impl, double priority)
         v.tileId.y &= ~255;
         v.localId.x &= ~255;
         v.localId.y &= ~255;
-        std::string boundName = bound->urlMeta(v);
         std::shared_ptr<BoundMetaTile> bmt
-                = impl->map->getBoundMetaTile(boundName);
+                = impl->map->getBoundMetaTile(bound->urlMeta, v);
         bmt->updatePriority(priority);
         switch (impl->map->getResourceValidity(bmt))
         {
@@ -165,7 +164,8 @@ Validity BoundParamInfo::prepareDepth(CameraImpl *impl, double priority)
 
     transparent = bound->isTransparent || (!!alpha && *alpha < 1);
 
-    textureColor = impl->map->getTexture(bound->urlExtTex(vars));
+    textureColor = impl->map->getTexture(bound->urlExtTex, vars,
+        impl->map->options.textureCompressionBoundLayers);
     textureColor->updatePriority(priority);
     textureColor->updateAvailability(bound->availability);
     switch (impl->map->getResourceValidity(textureColor))
@@ -179,7 +179,7 @@ Validity BoundParamInfo::prepareDepth(CameraImpl *impl, double priority)
     }
     if (!watertight)
     {
-        textureMask = impl->map->getTexture(bound->urlMask(vars));
+        textureMask = impl->map->getTexture(bound->urlMask, vars);
         textureMask->updatePriority(priority);
         switch (impl->map->getResourceValidity(textureMask))
         {
@@ -64,7 +64,8 @@ std::shared_ptr<GpuTexture> CameraImpl::travInternalTexture(
 {
     UrlTemplate::Vars vars(trav->id, trav->meta->localId, subMeshIndex);
     std::shared_ptr<GpuTexture> res = map->getTexture(
-                trav->surface->urlIntTex(vars));
+                trav->surface->urlIntTex, vars,
+                map->options.textureCompressionSurfaces);
     map->touchResource(res);
     res->updatePriority(trav->priority);
     return res;
@@ -148,7 +149,7 @@ bool CameraImpl::travDetermineMeta(TraverseNode *trav)
                 continue;
         }
         auto m = map->getMetaTile(trav->layer->surfaceStack.surfaces[i]
-                             .urlMeta(tileIdVars));
+                             .urlMeta, tileIdVars);
         // metatiles have higher priority than other resources
         m->updatePriority(trav->priority * 2);
         switch (map->getResourceValidity(m))
@@ -258,9 +259,8 @@ bool CameraImpl::travDetermineDrawsSurface(TraverseNode *trav)
     // aggregate mesh
     if (!trav->meshAgg)
     {
-        const std::string name = trav->surface->urlMesh(
+        trav->meshAgg = map->getMeshAggregate(trav->surface->urlMesh,
             UrlTemplate::Vars(nodeId, trav->meta->localId));
-        trav->meshAgg = map->getMeshAggregate(name);
 
         // prefetch internal textures
         /*
@@ -0,0 +1,83 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef DOWNLOADSLIMITER_HPP_b5n7m2k4
+#define DOWNLOADSLIMITER_HPP_b5n7m2k4
+
+#include <mutex>
+#include <chrono>
+
+#include "include/vts-browser/foundation.hpp"
+
+namespace vts
+{
+
+class MapRuntimeOptions;
+
+// adapts the number of concurrent downloads
+//   to the observed latency and throughput
+// the delay of each download is normalized by the time its body
+//   would take at the highest observed throughput,
+//   the delay over the lowest one is the time spent waiting in a queue
+//   somewhere on the way, and multiplied by the rate of downloads
+//   estimates the number of queued requests (little's law)
+// the limit is increased additively while the queue is short
+//   and decreased multiplicatively when it grows (similar to tcp vegas)
+class DownloadsLimiter
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    // may be called from any thread
+    void finished(Clock::time_point started, uint32 bytes);
+
+    // current limit of concurrent downloads
+    uint32 limit(const MapRuntimeOptions &options);
+
+    void statistics(uint32 &latencyMs, uint32 &throughputKBps) const;
+
+private:
+    mutable std::mutex mut;
+    Clock::time_point lastDecrease;
+    Clock::time_point throughputStart;
+    Clock::time_point delayBaseStart;
+    double window = 0; // zero until first limit call
+    double windowMin = 1;
+    double windowMax = 1;
+    double latencyAvg = 0; // ms, including the body transfer
+    double delayAvg = 0; // ms, normalized by the size
+    double delayBaseCur = 0; // ms, lowest delay in current period
+    double delayBasePrev = 0; // ms, lowest delay in previous period
+    double throughputAvg = 0; // bytes per second
+    double throughputMax = 0; // bytes per second, slowly decays
+    double rateAvg = 0; // downloads per second
+    uint64 throughputBytes = 0;
+    uint32 throughputCount = 0;
+};
+
+} // namespace vts
+
+#endif
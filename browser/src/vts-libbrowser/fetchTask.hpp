@@ -29,6 +29,8 @@
 
 #include <memory>
 #include <string>
+#include <atomic>
+#include <chrono>
 
 #include "include/vts-browser/fetcher.hpp"
 
@@ -36,7 +38,9 @@ namespace vts
 {
 
 class MapImpl;
+class MapSharedContextImpl;
 class Resource;
+class CacheData;
 
 class FetchTaskImpl : public FetchTask
 {
@@ -48,11 +52,26 @@ public:
 
     const std::string name;
     MapImpl *const map = nullptr;
+    const uint64 mapId = 0;
+    // guards the map against destruction while the reply is processed
+    std::weak_ptr<MapSharedContextImpl> context;
     std::shared_ptr<void> availTest; // vtslibs::registry::BoundLayer::Availability
     std::weak_ptr<Resource> resource;
+    std::shared_ptr<CacheData> stale; // expired cache entry to revalidate
     uint32 redirectionsCount = 0;
+    std::chrono::steady_clock::time_point started;
+    // set by whichever comes first: fetchDone or cancellation
+    std::atomic<bool> finished {false};
+
+private:
+    void process();
 };
 
+// availTest is vtslibs::registry::BoundLayer::Availability
+//   returns true if there is no test
+bool performAvailTest(const std::shared_ptr<void> &availTest,
+    const FetchTask::Reply &reply);
+
 } // namespace vts
 
 #endif
@@ -27,6 +27,8 @@
 #include "../include/vts-browser/fetcher.hpp"
 
 #include <fstream>
+#include <mutex>
+#include <unordered_map>
 #include <http/http.hpp>
 #include <http/resourcefetcher.hpp>
 
@@ -51,6 +53,7 @@ public:
     const uint32 id;
     http::ResourceFetcher::Query query;
     std::shared_ptr<FetchTask> task;
+    std::atomic<bool> cancelled;
     bool called;
 };
 
@@ -102,6 +105,10 @@ public:
         assert(initCount > 0);
         assert(task->reply.code == 0);
         auto t = std::make_shared<Task>(this, task);
+        {
+            std::lock_guard<std::mutex> lock(tasksMutex);
+            tasks[task.get()] = t;
+        }
         fetcher.perform(t->query, std::bind(&Task::done, t,
                                             std::placeholders::_1));
         if (extraLog)
@@ -111,6 +118,25 @@ public:
         }
     }
 
+    void cancel(const std::shared_ptr<FetchTask> &task) override
+    {
+        std::shared_ptr<Task> t;
+        {
+            std::lock_guard<std::mutex> lock(tasksMutex);
+            auto it = tasks.find(task.get());
+            if (it == tasks.end())
+                return;
+            t = it->second.lock();
+        }
+        if (!t)
+            return;
+        // the http fetcher cannot abort the transfer,
+        //   but the content is discarded as soon as it arrives
+        t->cancelled = true;
+        if (extraLog)
+            extraLog << time() << " cancel " << t->id << std::endl;
+    }
+
     uint64 time()
     {
         auto now = std::chrono::high_resolution_clock::now();
@@ -123,13 +149,15 @@ public:
     http::ResourceFetcher fetcher;
     std::atomic<int> initCount;
     std::atomic<uint32> taskId;
+    std::unordered_map<FetchTask*, std::weak_ptr<Task>> tasks;
+    std::mutex tasksMutex;
     std::ofstream extraLog;
     std::chrono::high_resolution_clock::time_point begin;
 };
 
 Task::Task(FetcherImpl *impl, const std::shared_ptr<FetchTask> &task)
     : begin(impl->time()), impl(impl), id(impl->taskId++),
-      query(task->query.url), task(task), called(false)
+      query(task->query.url), task(task), cancelled(false), called(false)
 {
     query.timeout(impl->options.timeout);
     for (auto it : task->query.headers)
@@ -155,20 +183,26 @@ void Task::done(utility::ResourceFetcher::MultiQuery &&queries)
     assert(queries.size() == 1);
     assert(task->reply.code == 0);
     http::ResourceFetcher::Query &q = *queries.begin();
-    if (q.valid())
+    if (cancelled)
+    {
+        task->reply.code = FetchTask::ExtraCodes::Cancelled;
+    }
+    else if (q.valid())
     {
-        const http::ResourceFetcher::Query::Body &body = q.get();
+        // the queries are owned by this callback
+        //   and the body may be taken over
+        http::ResourceFetcher::Query::Body &body
+            = const_cast<http::ResourceFetcher::Query::Body &>(q.get());
         if (body.redirect)
         {
             task->reply.code = body.redirect.value();
         }
         else
         {
-            task->reply.content.allocate(body.data.size());
-            memcpy(task->reply.content.data(), body.data.data(),
-                   body.data.size());
+            task->reply.content = Buffer(std::move(body.data));
             task->reply.contentType = body.contentType;
             task->reply.expires = body.expires;
+            task->reply.lastModified = body.lastModified;
             task->reply.code = 200;
 
             // testing start
@@ -218,6 +252,10 @@ void Task::finish()
 {
     assert(!called);
     called = true;
+    {
+        std::lock_guard<std::mutex> lock(impl->tasksMutex);
+        impl->tasks.erase(task.get());
+    }
     if (impl->extraLog)
     {
         impl->extraLog << 
@@ -232,8 +270,13 @@ void Task::finish()
 
 std::shared_ptr<Fetcher> Fetcher::create(const FetcherOptions &options)
 {
-    return std::dynamic_pointer_cast<Fetcher>(
+    if (!options.replayPath.empty())
+        return createReplay(options);
+    auto f = std::dynamic_pointer_cast<Fetcher>(
                 std::make_shared<FetcherImpl>(options));
+    if (!options.recordPath.empty())
+        return createRecorder(options, f);
+    return f;
 }
 
 } // namespace vts
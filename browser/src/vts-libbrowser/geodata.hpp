@@ -83,6 +83,7 @@ public:
     void upload() override;
     bool requiresUpload() override { return true; }
     FetchTask::ResourceType resourceType() const override;
+    MemoryType memoryType() const override { return MemoryType::geodata; }
     void update(
         const std::shared_ptr<GeodataStylesheet> &style,
         const std::shared_ptr<const std::string> &features,
@@ -50,6 +50,7 @@ public:
     void upload() override;
     bool requiresUpload() override { return true; }
     FetchTask::ResourceType resourceType() const override;
+    MemoryType memoryType() const override { return MemoryType::meshes; }
     uint32 faces = 0;
 };
 
@@ -65,6 +66,7 @@ public:
         = GpuTextureSpec::FilterMode::Linear;
     GpuTextureSpec::WrapMode wrapMode
         = GpuTextureSpec::WrapMode::ClampToEdge;
+    TextureCompression compression = TextureCompression::None;
     uint32 width = 0, height = 0;
 };
 
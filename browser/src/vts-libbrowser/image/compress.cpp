@@ -0,0 +1,507 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "image.hpp"
+
+#include <dbglog/dbglog.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace vts
+{
+
+namespace
+{
+
+typedef uint8 Pixels[16][4]; // rgba, row major
+
+// splits the image into 4x4 blocks
+//   edge blocks of images with sizes not divisible by 4 repeat the last pixels
+template<class F>
+void compressBlocks(const Buffer &in, Buffer &out,
+    uint32 width, uint32 height, uint32 components,
+    uint32 blockSize, F encodeBlock)
+{
+    if (components != 3 && components != 4)
+    {
+        LOGTHROW(err2, std::invalid_argument)
+            << "Texture compression requires rgb or rgba image";
+    }
+    if (in.size() != width * height * components)
+    {
+        LOGTHROW(err2, std::invalid_argument)
+            << "Buffer with data for texture compression has invalid size";
+    }
+    const uint32 bw = (width + 3) / 4;
+    const uint32 bh = (height + 3) / 4;
+    out.allocate(bw * bh * blockSize);
+    const uint8 *src = (const uint8 *)in.data();
+    uint8 *dst = (uint8 *)out.data();
+    Pixels px;
+    for (uint32 by = 0; by < bh; by++)
+    {
+        for (uint32 bx = 0; bx < bw; bx++)
+        {
+            for (uint32 y = 0; y < 4; y++)
+            {
+                uint32 sy = std::min(by * 4 + y, height - 1);
+                for (uint32 x = 0; x < 4; x++)
+                {
+                    uint32 sx = std::min(bx * 4 + x, width - 1);
+                    const uint8 *s = src + (sy * width + sx) * components;
+                    uint8 *p = px[y * 4 + x];
+                    p[0] = s[0];
+                    p[1] = s[1];
+                    p[2] = s[2];
+                    p[3] = components == 4 ? s[3] : 255;
+                }
+            }
+            encodeBlock(px, dst);
+            dst += blockSize;
+        }
+    }
+}
+
+int clamp255(int v)
+{
+    return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+int sqr(int v)
+{
+    return v * v;
+}
+
+////////////////////////////
+// BC1 / BC3
+////////////////////////////
+
+uint16 pack565(const int c[3])
+{
+    return (uint16)((((c[0] * 31 + 127) / 255) << 11)
+        | (((c[1] * 63 + 127) / 255) << 5)
+        | ((c[2] * 31 + 127) / 255));
+}
+
+void unpack565(uint16 v, int c[3])
+{
+    int r = v >> 11, g = (v >> 5) & 63, b = v & 31;
+    c[0] = (r << 3) | (r >> 2);
+    c[1] = (g << 2) | (g >> 4);
+    c[2] = (b << 3) | (b >> 2);
+}
+
+// endpoints are the extreme colors along the principal axis
+void encodeBc1Color(const Pixels &px, uint8 *dst)
+{
+    float mean[3] = { 0, 0, 0 };
+    for (uint32 i = 0; i < 16; i++)
+        for (uint32 c = 0; c < 3; c++)
+            mean[c] += px[i][c];
+    for (uint32 c = 0; c < 3; c++)
+        mean[c] /= 16;
+    float cov[3][3] = {};
+    for (uint32 i = 0; i < 16; i++)
+    {
+        float d[3];
+        for (uint32 c = 0; c < 3; c++)
+            d[c] = px[i][c] - mean[c];
+        for (uint32 a = 0; a < 3; a++)
+            for (uint32 b = 0; b < 3; b++)
+                cov[a][b] += d[a] * d[b];
+    }
+    float axis[3] = { 1, 1, 1 };
+    for (uint32 it = 0; it < 4; it++)
+    {
+        float n[3];
+        for (uint32 a = 0; a < 3; a++)
+            n[a] = cov[a][0] * axis[0] + cov[a][1] * axis[1]
+                + cov[a][2] * axis[2];
+        float m = std::max(std::abs(n[0]),
+            std::max(std::abs(n[1]), std::abs(n[2])));
+        if (m < 1e-6f)
+            break;
+        for (uint32 a = 0; a < 3; a++)
+            axis[a] = n[a] / m;
+    }
+    uint32 iMin = 0, iMax = 0;
+    float dMin = 1e30f, dMax = -1e30f;
+    for (uint32 i = 0; i < 16; i++)
+    {
+        float d = px[i][0] * axis[0] + px[i][1] * axis[1]
+            + px[i][2] * axis[2];
+        if (d < dMin)
+        {
+            dMin = d;
+            iMin = i;
+        }
+        if (d > dMax)
+        {
+            dMax = d;
+            iMax = i;
+        }
+    }
+
+    int e0[3], e1[3];
+    for (uint32 c = 0; c < 3; c++)
+    {
+        e0[c] = px[iMax][c];
+        e1[c] = px[iMin][c];
+    }
+    uint16 c0 = pack565(e0);
+    uint16 c1 = pack565(e1);
+    if (c0 < c1)
+        std::swap(c0, c1);
+    uint32 indices = 0;
+    if (c0 != c1)
+    {
+        // four color mode (c0 > c1)
+        int pal[4][3];
+        unpack565(c0, pal[0]);
+        unpack565(c1, pal[1]);
+        for (uint32 c = 0; c < 3; c++)
+        {
+            pal[2][c] = (2 * pal[0][c] + pal[1][c]) / 3;
+            pal[3][c] = (pal[0][c] + 2 * pal[1][c]) / 3;
+        }
+        for (uint32 i = 0; i < 16; i++)
+        {
+            uint32 best = 0;
+            int bestErr = 1 << 30;
+            for (uint32 j = 0; j < 4; j++)
+            {
+                int err = sqr(px[i][0] - pal[j][0])
+                    + sqr(px[i][1] - pal[j][1])
+                    + sqr(px[i][2] - pal[j][2]);
+                if (err < bestErr)
+                {
+                    bestErr = err;
+                    best = j;
+                }
+            }
+            indices |= best << (i * 2);
+        }
+    }
+    dst[0] = c0 & 0xff;
+    dst[1] = c0 >> 8;
+    dst[2] = c1 & 0xff;
+    dst[3] = c1 >> 8;
+    for (uint32 i = 0; i < 4; i++)
+        dst[4 + i] = (indices >> (i * 8)) & 0xff;
+}
+
+// eight interpolated values between the lowest and highest alpha
+void encodeBc3Alpha(const Pixels &px, uint8 *dst)
+{
+    int a0 = 0, a1 = 255;
+    for (uint32 i = 0; i < 16; i++)
+    {
+        a0 = std::max(a0, (int)px[i][3]);
+        a1 = std::min(a1, (int)px[i][3]);
+    }
+    uint64 bits = 0;
+    if (a0 > a1)
+    {
+        int range = a0 - a1;
+        for (uint32 i = 0; i < 16; i++)
+        {
+            // number of steps from a0 towards a1
+            uint64 t = ((a0 - px[i][3]) * 7 + range / 2) / range;
+            uint64 code = t == 0 ? 0 : t == 7 ? 1 : t + 1;
+            bits |= code << (i * 3);
+        }
+    }
+    dst[0] = a0;
+    dst[1] = a1;
+    for (uint32 i = 0; i < 6; i++)
+        dst[2 + i] = (bits >> (i * 8)) & 0xff;
+}
+
+////////////////////////////
+// ETC2
+////////////////////////////
+
+const int etcModifiers[8][4] = {
+    { 2, 8, -2, -8 },
+    { 5, 17, -5, -17 },
+    { 9, 29, -9, -29 },
+    { 13, 42, -13, -42 },
+    { 18, 60, -18, -60 },
+    { 24, 80, -24, -80 },
+    { 33, 106, -33, -106 },
+    { 47, 183, -47, -183 },
+};
+
+const int eacModifiers[16][8] = {
+    { -3, -6, -9, -15, 2, 5, 8, 14 },
+    { -3, -7, -10, -13, 2, 6, 9, 12 },
+    { -2, -5, -8, -13, 1, 4, 7, 12 },
+    { -2, -4, -6, -13, 1, 3, 5, 12 },
+    { -3, -6, -8, -12, 2, 5, 7, 11 },
+    { -3, -7, -9, -11, 2, 6, 8, 10 },
+    { -4, -7, -8, -11, 3, 6, 7, 10 },
+    { -3, -5, -8, -11, 2, 4, 7, 10 },
+    { -2, -6, -8, -10, 1, 5, 7, 9 },
+    { -2, -5, -8, -10, 1, 4, 7, 9 },
+    { -2, -4, -8, -10, 1, 3, 7, 9 },
+    { -2, -5, -7, -10, 1, 4, 6, 9 },
+    { -3, -4, -7, -10, 2, 3, 6, 9 },
+    { -1, -2, -3, -10, 0, 1, 2, 9 },
+    { -4, -6, -8, -9, 3, 5, 7, 8 },
+    { -3, -5, -7, -9, 2, 4, 6, 8 },
+};
+
+struct EtcSubblock
+{
+    uint32 pixels[8]; // indices into the row major block
+    uint32 selectors[8];
+    uint32 table;
+};
+
+// finds the modifier table and per pixel selectors for the base color
+// the modifier is added to all channels, therefore the selector
+//   is chosen by the average difference of the pixel from the base
+int etcFitSubblock(const Pixels &px, EtcSubblock &sb, const int base[3])
+{
+    int delta[8];
+    for (uint32 i = 0; i < 8; i++)
+    {
+        const uint8 *p = px[sb.pixels[i]];
+        delta[i] = (p[0] + p[1] + p[2] - base[0] - base[1] - base[2]) / 3;
+    }
+    int bestErr = 1 << 30;
+    for (uint32 t = 0; t < 8; t++)
+    {
+        const int *mods = etcModifiers[t];
+        int err = 0;
+        uint32 sel[8];
+        for (uint32 i = 0; i < 8 && err < bestErr; i++)
+        {
+            int d = delta[i];
+            uint32 s = d >= 0
+                ? (std::abs(d - mods[0]) <= std::abs(d - mods[1]) ? 0 : 1)
+                : (std::abs(d - mods[2]) <= std::abs(d - mods[3]) ? 2 : 3);
+            int m = mods[s];
+            const uint8 *p = px[sb.pixels[i]];
+            err += sqr(clamp255(base[0] + m) - p[0])
+                + sqr(clamp255(base[1] + m) - p[1])
+                + sqr(clamp255(base[2] + m) - p[2]);
+            sel[i] = s;
+        }
+        if (err < bestErr)
+        {
+            bestErr = err;
+            sb.table = t;
+            std::copy(sel, sel + 8, sb.selectors);
+        }
+    }
+    return bestErr;
+}
+
+// etc1 compatible individual and differential modes
+//   with both subblock orientations
+void encodeEtc2Color(const Pixels &px, uint8 *dst)
+{
+    uint64 bestBlock = 0;
+    int bestErr = -1;
+    for (uint32 flip = 0; flip < 2; flip++)
+    {
+        EtcSubblock sb[2];
+        int avg[2][3] = {};
+        for (uint32 s = 0; s < 2; s++)
+        {
+            uint32 n = 0;
+            for (uint32 y = 0; y < 4; y++)
+            {
+                for (uint32 x = 0; x < 4; x++)
+                {
+                    if ((flip ? y / 2 : x / 2) != s)
+                        continue;
+                    sb[s].pixels[n++] = y * 4 + x;
+                    for (uint32 c = 0; c < 3; c++)
+                        avg[s][c] += px[y * 4 + x][c];
+                }
+            }
+            for (uint32 c = 0; c < 3; c++)
+                avg[s][c] = (avg[s][c] + 4) / 8;
+        }
+
+        // differential mode is more precise if the colors are close
+        int q[2][3], base[2][3];
+        bool diff = true;
+        for (uint32 c = 0; c < 3; c++)
+        {
+            q[0][c] = (avg[0][c] * 31 + 127) / 255;
+            q[1][c] = (avg[1][c] * 31 + 127) / 255;
+            int d = q[1][c] - q[0][c];
+            if (d < -4 || d > 3)
+                diff = false;
+        }
+        for (uint32 s = 0; s < 2; s++)
+        {
+            for (uint32 c = 0; c < 3; c++)
+            {
+                if (diff)
+                    base[s][c] = (q[s][c] << 3) | (q[s][c] >> 2);
+                else
+                {
+                    q[s][c] = (avg[s][c] * 15 + 127) / 255;
+                    base[s][c] = q[s][c] * 17;
+                }
+            }
+        }
+        int err = etcFitSubblock(px, sb[0], base[0])
+            + etcFitSubblock(px, sb[1], base[1]);
+        if (bestErr >= 0 && err >= bestErr)
+            continue;
+        bestErr = err;
+
+        uint64 b = 0;
+        for (uint32 c = 0; c < 3; c++)
+        {
+            uint32 shift = 56 - c * 8;
+            if (diff)
+            {
+                b |= (uint64)q[0][c] << (shift + 3);
+                b |= (uint64)((q[1][c] - q[0][c]) & 7) << shift;
+            }
+            else
+            {
+                b |= (uint64)q[0][c] << (shift + 4);
+                b |= (uint64)q[1][c] << shift;
+            }
+        }
+        b |= (uint64)sb[0].table << 37;
+        b |= (uint64)sb[1].table << 34;
+        b |= (uint64)diff << 33;
+        b |= (uint64)flip << 32;
+        for (uint32 s = 0; s < 2; s++)
+        {
+            for (uint32 i = 0; i < 8; i++)
+            {
+                // pixels are numbered in column major order
+                uint32 p = sb[s].pixels[i];
+                uint32 k = (p % 4) * 4 + p / 4;
+                uint32 sel = sb[s].selectors[i];
+                b |= (uint64)(sel >> 1) << (16 + k);
+                b |= (uint64)(sel & 1) << k;
+            }
+        }
+        bestBlock = b;
+    }
+    for (uint32 i = 0; i < 8; i++)
+        dst[i] = (bestBlock >> (56 - i * 8)) & 0xff;
+}
+
+void encodeEac(const Pixels &px, uint8 *dst)
+{
+    int lo = 255, hi = 0;
+    for (uint32 i = 0; i < 16; i++)
+    {
+        lo = std::min(lo, (int)px[i][3]);
+        hi = std::max(hi, (int)px[i][3]);
+    }
+    const int base = (lo + hi + 1) / 2;
+    uint64 bestBits = 0;
+    int bestErr = 1 << 30;
+    for (uint32 t = 0; t < 16; t++)
+    {
+        const int *mods = eacModifiers[t];
+        int range = mods[7] - mods[3];
+        int mult = std::max(1, std::min(15, (hi - lo + range / 2) / range));
+        int err = 0;
+        uint64 bits = 0;
+        for (uint32 i = 0; i < 16 && err < bestErr; i++)
+        {
+            int a = px[i][3];
+            int pixErr = 1 << 30;
+            uint64 sel = 0;
+            for (uint32 s = 0; s < 8; s++)
+            {
+                int e = sqr(clamp255(base + mods[s] * mult) - a);
+                if (e < pixErr)
+                {
+                    pixErr = e;
+                    sel = s;
+                }
+            }
+            err += pixErr;
+            // pixels are numbered in column major order
+            uint32 k = (i % 4) * 4 + i / 4;
+            bits |= sel << (45 - k * 3);
+        }
+        if (err < bestErr)
+        {
+            bestErr = err;
+            bestBits = bits | ((uint64)base << 56)
+                | ((uint64)mult << 52) | ((uint64)t << 48);
+        }
+    }
+    for (uint32 i = 0; i < 8; i++)
+        dst[i] = (bestBits >> (56 - i * 8)) & 0xff;
+}
+
+} // namespace
+
+void compressBc1(const Buffer &in, Buffer &out,
+                 uint32 width, uint32 height, uint32 components)
+{
+    compressBlocks(in, out, width, height, components, 8,
+        [](const Pixels &px, uint8 *dst) {
+            encodeBc1Color(px, dst);
+        });
+}
+
+void compressBc3(const Buffer &in, Buffer &out,
+                 uint32 width, uint32 height, uint32 components)
+{
+    compressBlocks(in, out, width, height, components, 16,
+        [](const Pixels &px, uint8 *dst) {
+            encodeBc3Alpha(px, dst);
+            encodeBc1Color(px, dst + 8);
+        });
+}
+
+void compressEtc2Rgb(const Buffer &in, Buffer &out,
+                     uint32 width, uint32 height, uint32 components)
+{
+    compressBlocks(in, out, width, height, components, 8,
+        [](const Pixels &px, uint8 *dst) {
+            encodeEtc2Color(px, dst);
+        });
+}
+
+void compressEtc2Rgba(const Buffer &in, Buffer &out,
+                      uint32 width, uint32 height, uint32 components)
+{
+    compressBlocks(in, out, width, height, components, 16,
+        [](const Pixels &px, uint8 *dst) {
+            encodeEac(px, dst);
+            encodeEtc2Color(px, dst + 8);
+        });
+}
+
+} // namespace vts
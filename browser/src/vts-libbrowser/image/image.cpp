@@ -33,7 +33,8 @@ namespace vts
 {
 
 void decodeImage(const Buffer &in, Buffer &out,
-                 uint32 &width, uint32 &height, uint32 &components)
+                 uint32 &width, uint32 &height, uint32 &components,
+                 bool bottomUp)
 {
     if (in.size() < 8)
         LOGTHROW(err1, std::runtime_error) << "insufficient image data";
@@ -42,9 +43,9 @@ void decodeImage(const Buffer &in, Buffer &out,
     static const unsigned char jpegSignature[]
         = { 0xFF, 0xD8, 0xFF };
     if (memcmp(in.data(), pngSignature, sizeof(pngSignature)) == 0)
-        decodePng(in, out, width, height, components);
+        decodePng(in, out, width, height, components, bottomUp);
     else if (memcmp(in.data(), jpegSignature, sizeof(jpegSignature)) == 0)
-        decodeJpeg(in, out, width, height, components);
+        decodeJpeg(in, out, width, height, components, bottomUp);
     else
     {
         // raw image data - assume square
@@ -52,7 +53,16 @@ void decodeImage(const Buffer &in, Buffer &out,
         width = height = std::sqrt(in.size() / components);
         if (in.size() != width * height * components)
             LOGTHROW(err1, std::runtime_error) << "Raw image is not square";
-        out = in.copy();
+        if (bottomUp)
+        {
+            uint32 lineSize = width * components;
+            out.allocate(in.size());
+            for (uint32 y = 0; y < height; y++)
+                memcpy(out.data() + (height - y - 1) * lineSize,
+                    in.data() + y * lineSize, lineSize);
+        }
+        else
+            out = in.copy();
     }
 }
 
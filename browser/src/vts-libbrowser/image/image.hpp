@@ -27,23 +27,52 @@
 #ifndef IMAGE_H_erweubdnu
 #define IMAGE_H_erweubdnu
 
+#include <vector>
+
 #include "../include/vts-browser/buffer.hpp"
 
 namespace vts
 {
 
+// bottomUp stores the last row of the image first (as expected by OpenGL)
+//   the rows are written directly to their place while decoding
+
 void decodePng(const Buffer &in, Buffer &out,
-               uint32 &width, uint32 &height, uint32 &components);
+               uint32 &width, uint32 &height, uint32 &components,
+               bool bottomUp = false);
 
 void decodeJpeg(const Buffer &in, Buffer &out,
-                uint32 &width, uint32 &height, uint32 &components);
+                uint32 &width, uint32 &height, uint32 &components,
+                bool bottomUp = false);
 
 void decodeImage(const Buffer &in, Buffer &out,
-                 uint32 &width, uint32 &height, uint32 &components);
+                 uint32 &width, uint32 &height, uint32 &components,
+                 bool bottomUp = false);
 
 void encodePng(const Buffer &in, Buffer &out,
                uint32 width, uint32 height, uint32 components);
 
+// block compression of rgb or rgba images with 8 bits per channel
+//   the output consists of 4x4 pixel blocks in row major order
+// bc1 and etc2 rgb ignore the alpha channel
+
+void compressBc1(const Buffer &in, Buffer &out,
+                 uint32 width, uint32 height, uint32 components);
+
+void compressBc3(const Buffer &in, Buffer &out,
+                 uint32 width, uint32 height, uint32 components);
+
+void compressEtc2Rgb(const Buffer &in, Buffer &out,
+                     uint32 width, uint32 height, uint32 components);
+
+void compressEtc2Rgba(const Buffer &in, Buffer &out,
+                      uint32 width, uint32 height, uint32 components);
+
+// all mipmap levels below the image, down to 1x1 pixel
+//   using box filter, rgb channels are averaged in linear color space
+void generateMipmaps(const Buffer &in, std::vector<Buffer> &levels,
+                     uint32 width, uint32 height, uint32 components);
+
 } // namespace vts
 
 #endif
@@ -48,7 +48,8 @@ void jpegErrFunc(j_common_ptr cinfo)
 } // namespace
 
 void decodeJpeg(const Buffer &in, Buffer &out,
-                uint32 &width, uint32 &height, uint32 &components)
+                uint32 &width, uint32 &height, uint32 &components,
+                bool bottomUp)
 {
     jpeg_decompress_struct info;
     jpeg_error_mgr errmgr;
@@ -67,9 +68,11 @@ void decodeJpeg(const Buffer &in, Buffer &out,
         out = Buffer(lineSize * height);
         while (info.output_scanline < info.output_height)
         {
+            uint32 y = info.output_scanline;
+            if (bottomUp)
+                y = height - y - 1;
             unsigned char *ptr[1];
-            ptr[0] = (unsigned char*)out.data()
-                    + lineSize * info.output_scanline;
+            ptr[0] = (unsigned char*)out.data() + lineSize * y;
             jpeg_read_scanlines(&info, ptr, 1);
         }
         jpeg_finish_decompress(&info);
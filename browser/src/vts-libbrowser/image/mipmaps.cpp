@@ -0,0 +1,129 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "image.hpp"
+
+#include <dbglog/dbglog.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace vts
+{
+
+namespace
+{
+
+// conversions between srgb and linear intensity
+//   linear values are scaled to 16 bits
+struct GammaTables
+{
+    uint16 toLinear[256];
+    uint8 toSrgb[1 << 14]; // indexed by the linear value >> 2
+
+    GammaTables()
+    {
+        for (uint32 i = 0; i < 256; i++)
+        {
+            double s = i / 255.0;
+            double l = s <= 0.04045 ? s / 12.92
+                : std::pow((s + 0.055) / 1.055, 2.4);
+            toLinear[i] = (uint16)(l * 65535 + 0.5);
+        }
+        for (uint32 i = 0; i < (1 << 14); i++)
+        {
+            double l = (i + 0.5) / (1 << 14);
+            double s = l <= 0.0031308 ? l * 12.92
+                : 1.055 * std::pow(l, 1 / 2.4) - 0.055;
+            toSrgb[i] = (uint8)std::min(s * 255 + 0.5, 255.0);
+        }
+    }
+};
+
+const GammaTables &gammaTables()
+{
+    static const GammaTables tables;
+    return tables;
+}
+
+// 2x2 box filter, the last row or column is repeated for odd sizes
+void downsample(const uint8 *src, uint32 sw, uint32 sh,
+    uint8 *dst, uint32 dw, uint32 dh, uint32 components)
+{
+    const GammaTables &g = gammaTables();
+    // color channels of rgb(a) images are averaged in linear space
+    const uint32 colors = components >= 3 ? 3 : 0;
+    const uint32 stride = sw * components;
+    for (uint32 y = 0; y < dh; y++)
+    {
+        const uint8 *r0 = src + std::min(y * 2, sh - 1) * stride;
+        const uint8 *r1 = src + std::min(y * 2 + 1, sh - 1) * stride;
+        for (uint32 x = 0; x < dw; x++)
+        {
+            const uint32 i0 = std::min(x * 2, sw - 1) * components;
+            const uint32 i1 = std::min(x * 2 + 1, sw - 1) * components;
+            for (uint32 c = 0; c < colors; c++)
+            {
+                uint32 l = g.toLinear[r0[i0 + c]] + g.toLinear[r0[i1 + c]]
+                    + g.toLinear[r1[i0 + c]] + g.toLinear[r1[i1 + c]];
+                *dst++ = g.toSrgb[l >> 4];
+            }
+            for (uint32 c = colors; c < components; c++)
+            {
+                *dst++ = (r0[i0 + c] + r0[i1 + c]
+                    + r1[i0 + c] + r1[i1 + c] + 2) / 4;
+            }
+        }
+    }
+}
+
+} // namespace
+
+void generateMipmaps(const Buffer &in, std::vector<Buffer> &levels,
+                     uint32 width, uint32 height, uint32 components)
+{
+    if (components < 1 || components > 4
+        || in.size() != width * height * components)
+    {
+        LOGTHROW(err2, std::invalid_argument)
+            << "Buffer with data for mipmaps generation has invalid size";
+    }
+    levels.clear();
+    const Buffer *prev = &in;
+    while (width > 1 || height > 1)
+    {
+        uint32 w = std::max(width / 2, 1u);
+        uint32 h = std::max(height / 2, 1u);
+        Buffer b(w * h * components);
+        downsample((const uint8 *)prev->data(), width, height,
+            (uint8 *)b.data(), w, h, components);
+        levels.push_back(std::move(b));
+        prev = &levels.back();
+        width = w;
+        height = h;
+    }
+}
+
+} // namespace vts
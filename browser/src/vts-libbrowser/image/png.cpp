@@ -94,7 +94,8 @@ void pngFlushFunc(png_structp)
 } // namespace
 
 void decodePng(const Buffer &in, Buffer &out,
-               uint32 &width, uint32 &height, uint32 &components)
+               uint32 &width, uint32 &height, uint32 &components,
+               bool bottomUp)
 {
     pngInfoCtx ctx;
     png_structp &png = ctx.png;
@@ -148,7 +149,8 @@ void decodePng(const Buffer &in, Buffer &out,
     assert(cols == png_get_rowbytes(png,info));
     out.allocate(height * cols);
     for (uint32 y = 0; y < height; y++)
-        rows[y] = (png_bytep)out.data() + y * cols;
+        rows[y] = (png_bytep)out.data()
+            + (bottomUp ? height - y - 1 : y) * cols;
     png_read_image(png, rows.data());
 }
 
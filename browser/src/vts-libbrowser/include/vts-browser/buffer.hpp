@@ -29,18 +29,30 @@
 
 #include <iostream>
 #include <string>
+#include <memory>
 
 #include "foundation.hpp"
 
 namespace vts
 {
 
+// the layout of the class changed with the shared storage (the owner),
+//   applications using the c++ interface must be recompiled,
+//   the c interface (and bindings built on it, eg. c# and unity)
+//   accesses the buffers through functions only and is not affected
 class VTS_API Buffer
 {
 public:
     Buffer();
     explicit Buffer(uint32 size); // create preallocated buffer (it is not zeroed)
     explicit Buffer(const std::string &str); // create buffer from string
+    explicit Buffer(std::string &&str); // take over the string storage (no copy)
+
+    // create buffer referencing memory kept alive by the owner
+    //   the memory may be read-only and must not be modified
+    // externally allocated storage is adopted by passing an owner
+    //   with appropriate deleter, eg. std::shared_ptr<void>(data, ::free)
+    Buffer(char *data, uint32 size, std::shared_ptr<void> owner);
     ~Buffer();
 
     // move semantics
@@ -54,6 +66,14 @@ public:
     // explicitly create a copy
     Buffer copy() const;
 
+    // create buffer sharing the storage with this buffer (no copy)
+    //   the content must not be modified while it is shared
+    Buffer share();
+
+    // create buffer sharing a part of the storage with this buffer (no copy)
+    //   the view inherits the restrictions of the storage
+    Buffer view(uint32 offset, uint32 size);
+
     // explicitly create string out of the buffer
     std::string str() const;
 
@@ -73,11 +93,18 @@ public:
 
     void free();
 
+    // the storage of a shared buffer may be read-only
+    //   (eg. memory mapped from the disk cache),
+    //   use copy() before modifying the content of a shared buffer
     char *data() const { return data_; }
     char *dataEnd() const { return data_ + size_; }
     uint32 size() const { return size_; }
 
+    // true if the storage may be referenced by other buffers
+    bool shared() const { return !!owner_; }
+
 private:
+    std::shared_ptr<void> owner_; // empty if the data is owned exclusively
     char *data_;
     uint32 size_;
 };
@@ -102,6 +129,10 @@ public:
     uint32 position() const;
 };
 
+// writes concatenation of the buffers into the file (through temporary file)
+VTS_API void writeLocalFileBuffers(const std::string &path,
+    const Buffer *const *buffers, uint32 count);
+
 // this will store the pointer directly!
 // the data it points to must never be freed!
 // the data may reside in text/code segment
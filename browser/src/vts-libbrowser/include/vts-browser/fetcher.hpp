@@ -68,6 +68,8 @@ public:
             Timeout = 10504,
             // Internal fetcher error.
             InternalError = 10500,
+            // Download was cancelled by the map.
+            Cancelled = 10499,
             // Content is not to be shown to the end user.
             ProhibitedContent = 10403,
             // Content is rejected to simulate errors for testing purposes.
@@ -95,6 +97,11 @@ public:
         //   -2 = always revalidate
         sint64 expires = -1;
 
+        // validators for conditional revalidation of cached content
+        //   empty or -1 if not provided
+        std::string etag;
+        sint64 lastModified = -1; // absolute time in seconds
+
         // http status code, or one of the ExtraCodes
         uint32 code = 0;
     };
@@ -136,6 +143,23 @@ public:
     // 2 = use http/2, fallback http/1
     // 3 = use http/2, fallback http/1.1
     sint32 pipelining = 2;
+
+    // store all downloads into the directory for later replay
+    std::string recordPath;
+
+    // serve all downloads from a directory recorded earlier
+    //   no network connections are made
+    std::string replayPath;
+
+    // simulated network conditions for the replay
+    // latency of each download is the recorded one multiplied by the scale
+    //   plus the extra latency and random jitter (in milliseconds)
+    // the bandwidth is shared by all downloads (bytes per second)
+    //   0 = unlimited
+    double replayLatencyScale = 1;
+    uint32 replayLatencyExtra = 0;
+    uint32 replayLatencyJitter = 0;
+    uint32 replayBandwidth = 0;
 };
 
 class VTS_API Fetcher : private Immovable
@@ -143,11 +167,25 @@ class VTS_API Fetcher : private Immovable
 public:
     static std::shared_ptr<Fetcher> create(const FetcherOptions &options);
 
+    // wraps the fetcher and stores all downloads into options.recordPath
+    static std::shared_ptr<Fetcher> createRecorder(
+        const FetcherOptions &options,
+        const std::shared_ptr<Fetcher> &fetcher);
+
+    // serves downloads recorded in options.replayPath
+    static std::shared_ptr<Fetcher> createReplay(
+        const FetcherOptions &options);
+
     virtual ~Fetcher();
     virtual void initialize();
     virtual void finalize();
     virtual void update();
     virtual void fetch(const std::shared_ptr<FetchTask> &) = 0;
+
+    // the task is no longer needed
+    // the fetcher may abort the download, but fetchDone must still be called
+    // may be called from any thread
+    virtual void cancel(const std::shared_ptr<FetchTask> &);
 };
 
 } // namespace vts
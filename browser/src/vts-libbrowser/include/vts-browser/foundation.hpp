@@ -126,6 +126,20 @@ enum class FreeLayerType
     MonolithicGeodata,
 };
 
+enum class TextureCompression
+{
+    // textures are passed to the gpu uncompressed
+    None,
+
+    // bc1 (rgb) and bc3 (rgba) formats (also known as s3tc or dxt)
+    //   widely supported by desktop gpus
+    Bc,
+
+    // etc2 rgb8 and rgba8 eac formats
+    //   mandatory in opengl es 3
+    Etc2,
+};
+
 #ifdef UTILITY_GENERATE_ENUM_IO
 
 UTILITY_GENERATE_ENUM_IO(Srs,
@@ -159,6 +173,12 @@ UTILITY_GENERATE_ENUM_IO(TraverseMode,
     ((Fixed)("fixed"))
 )
 
+UTILITY_GENERATE_ENUM_IO(TextureCompression,
+    ((None)("none"))
+    ((Bc)("bc"))
+    ((Etc2)("etc2"))
+)
+
 #endif // UTILITY_GENERATE_ENUM_IO
 
 struct Immovable
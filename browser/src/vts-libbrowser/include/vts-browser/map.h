@@ -58,6 +58,7 @@ VTS_API void vtsMapGetDefaultPosition(vtsHMap map, vtsHPosition position);
 
 // data processing (may be run on a dedicated thread)
 VTS_API void vtsMapDataUpdate(vtsHMap map);
+VTS_API void vtsMapDataUpdateBudget(vtsHMap map, double budgetMs);
 VTS_API void vtsMapDataAllRun(vtsHMap map);
 VTS_API void vtsMapDataFinalize(vtsHMap map);
 
@@ -39,6 +39,7 @@ namespace vts
 
 class MapCreateOptions;
 class Fetcher;
+class MapSharedContext;
 class Camera;
 class MapCallbacks;
 class MapStatistics;
@@ -46,6 +47,8 @@ class MapRuntimeOptions;
 class MapCelestialBody;
 class MapView;
 class SearchTask;
+class SeedingTask;
+class SeedingOptions;
 class MapImpl;
 class Position;
 
@@ -57,6 +60,10 @@ public:
     explicit Map(const MapCreateOptions &options);
     explicit Map(const MapCreateOptions &options,
         const std::shared_ptr<Fetcher> &fetcher);
+    // maps created with the same context share downloads,
+    //   the disk cache and the worker threads
+    explicit Map(const MapCreateOptions &options,
+        const std::shared_ptr<MapSharedContext> &context);
     ~Map();
 
     // mapconfigPath: url to mapconfig
@@ -97,6 +104,14 @@ public:
     // you should call it periodically
     void dataUpdate();
 
+    // dataUpdate with time budget (in milliseconds)
+    //   processes resources until the budget is spent
+    //   at least one resource is processed, if any is available
+    // an operation is not started if its expected duration
+    //   would exceed the budget
+    //   (estimated per byte of the resource from previous operations)
+    void dataUpdate(double budgetMs);
+
     // use dataFinalize to release all pending resources
     void dataFinalize();
 
@@ -166,6 +181,10 @@ public:
     std::shared_ptr<SearchTask> search(const std::string &query,
                      const std::array<double, 3> &lst); // navigation srs
 
+    // downloads a region of the map into the disk cache
+    // requires the mapconfig to be ready
+    std::shared_ptr<SeedingTask> seed(const SeedingOptions &options);
+
 private:
     std::shared_ptr<MapImpl> impl;
 };
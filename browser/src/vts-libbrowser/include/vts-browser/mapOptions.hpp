@@ -65,6 +65,15 @@ public:
     std::string customSrs1;
     std::string customSrs2;
 
+    // number of threads used for decoding downloaded resources
+    // 0 = deduce from hardware concurrency
+    //     (leaving two cores for the render and data threads)
+    uint32 decodeThreads = 0;
+
+    // number of threads reading resources from the disk cache
+    // multiple threads keep more reads in flight on slow disks
+    uint32 cacheReadThreads = 4;
+
     // use hard drive cache for downloads
     bool diskCache;
 
@@ -74,6 +83,24 @@ public:
     //          is clearly reflected in the cached file name
     bool hashCachePaths = true;
 
+    // store the disk cache in large segment files with an index
+    //   instead of one file per resource
+    // the segments are memory mapped for reading
+    // not available on windows
+    bool diskCachePacked = false;
+
+    // maximum size of the disk cache
+    // expired and least recently read entries are evicted
+    //   when the limit is exceeded
+    // zero for unlimited
+    uint32 diskCacheMaxSizeMB = 0;
+
+    // compress entries in the disk cache
+    // applies to resources that are not compressed already
+    //   (meshes, metatiles, geodata, configs, ...)
+    // images (textures, navtiles, ...) are always stored raw
+    bool diskCacheCompression = false;
+
     // use search url/srs fallbacks on any body (not just Earth)
     bool searchUrlFallbackOutsideEarth = false;
 
@@ -107,16 +134,42 @@ public:
     // memory threshold at which resources start to be released
     uint32 targetResourcesMemoryKB = 0;
 
+    // separate thresholds for ram and gpu memory (zero to disable)
+    // the gpu threshold is a hard limit,
+    //   recently used resources are released too when it is exceeded
+    uint32 targetResourcesRamKB = 0;
+    uint32 targetResourcesGpuKB = 0;
+
+    // thresholds for memory (ram + gpu) used
+    //   by individual types of resources (zero to disable)
+    uint32 targetTexturesMemoryKB = 0;
+    uint32 targetMeshesMemoryKB = 0;
+    uint32 targetMetatilesMemoryKB = 0;
+    uint32 targetGeodataMemoryKB = 0;
+    uint32 targetFontsMemoryKB = 0;
+
     // maximum size of the queue for the resources to be downloaded
     uint32 maxConcurrentDownloads = 25;
 
+    // adapt the number of concurrent downloads to the observed latency
+    //   and throughput, between the min and max limits
+    bool adaptiveConcurrentDownloads = false;
+    uint32 minConcurrentDownloads = 4;
+
     // maximum number of items waiting in queue to be written to disk cache
     // new resources will be skipped when the queue is full
     uint32 maxCacheWriteQueueLength = 500;
 
     // maximum number of resources processed per dataTick
+    //   (not applied when dataUpdate is given a time budget)
     uint32 maxResourceProcessesPerTick = 10;
 
+    // maximum size (in KB) of resources uploaded per dataTick
+    //   measured as the gpu memory of the uploaded resources
+    //   a resource is not started if its expected size would exceed it
+    //   zero to disable
+    uint32 maxResourceUploadKBPerTick = 0;
+
     // maximum number of redirections before the download fails
     // this is to prevent infinite loops
     uint32 maxFetchRedirections = 5;
@@ -128,6 +181,21 @@ public:
     // each subsequent retry is delayed twice as long as before
     uint32 fetchFirstRetryTimeOffset = 1;
 
+    // compress textures on the decode threads to reduce gpu memory use
+    //   separately for internal textures of surfaces
+    //   and for textures of bound layers
+    // the renderer must support the chosen format
+    // applies to textures created after the change
+    TextureCompression textureCompressionSurfaces = TextureCompression::None;
+    TextureCompression textureCompressionBoundLayers
+        = TextureCompression::None;
+
+    // generate mipmaps of textures on the decode threads
+    //   instead of leaving it to the gpu driver during upload
+    // applies to textures with filtering that requires mipmaps
+    //   (compressed textures keep such filtering only with this option)
+    bool textureMipmapsOnDecode = false;
+
     // 0 = US customary units
     // 1 = metric
     // when new instance of this structure is created,
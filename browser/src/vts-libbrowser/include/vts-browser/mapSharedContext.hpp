@@ -0,0 +1,58 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MAP_SHARED_CONTEXT_HPP_sdfgh4jk
+#define MAP_SHARED_CONTEXT_HPP_sdfgh4jk
+
+#include <memory>
+
+#include "foundation.hpp"
+
+namespace vts
+{
+
+class MapCreateOptions;
+class Fetcher;
+
+// context that may be shared by multiple maps in single process
+// the maps share the fetcher (concurrent downloads of same url
+//   are merged into single download), the disk cache
+//   and the threads for decoding resources and writing the cache
+// the context is configured by the options given here,
+//   the corresponding options given to individual maps are ignored
+class VTS_API MapSharedContext : private Immovable
+{
+public:
+    static std::shared_ptr<MapSharedContext> create(
+        const MapCreateOptions &options,
+        const std::shared_ptr<Fetcher> &fetcher);
+
+    virtual ~MapSharedContext();
+};
+
+} // namespace vts
+
+#endif
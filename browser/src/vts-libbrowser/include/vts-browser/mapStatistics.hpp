@@ -42,7 +42,9 @@ public:
 
     uint32 resourcesCreated;
     uint32 resourcesDownloaded;
+    uint32 resourcesCancelled;
     uint32 resourcesDiskLoaded;
+    uint32 resourcesRevalidated;
     uint32 resourcesDecoded;
     uint32 resourcesUploaded;
     uint32 resourcesFailed;
@@ -59,8 +61,17 @@ public:
     uint32 resourcesQueueGeodata;
     uint32 resourcesQueueAtmosphere;
 
+    uint32 currentDownloadsLimit;
+    uint32 currentDownloadLatencyMs; // average
+    uint32 currentDownloadThroughputKBps; // average
+
     uint32 currentGpuMemUseKB;
     uint32 currentRamMemUseKB;
+    uint32 currentTexturesMemUseKB;
+    uint32 currentMeshesMemUseKB;
+    uint32 currentMetatilesMemUseKB;
+    uint32 currentGeodataMemUseKB;
+    uint32 currentFontsMemUseKB;
 
     uint32 renderTicks;
 };
@@ -29,6 +29,7 @@
 
 #include <array>
 #include <memory>
+#include <vector>
 
 #include "buffer.hpp"
 
@@ -70,7 +71,10 @@ class VTS_API GpuTextureSpec
 {
 public:
     GpuTextureSpec() = default;
-    explicit GpuTextureSpec(const Buffer &buffer); // decode jpg or png file
+    // decode jpg or png file
+    //   verticalFlip stores the rows bottom-up while decoding,
+    //   which is faster than calling verticalFlip afterwards
+    explicit GpuTextureSpec(const Buffer &buffer, bool verticalFlip = false);
     void verticalFlip();
 
     // image resolution
@@ -87,13 +91,36 @@ public:
     // the type must still be set appropriately since it defines buffer size
     uint32 internalFormat = 0;
 
+    // internal formats of block compressed textures
+    //   (compatible with OpenGL)
+    enum class CompressedFormat
+    {
+        Bc1Rgb = 0x83F0, // GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+        Bc3Rgba = 0x83F3, // GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+        Etc2Rgb = 0x9274, // GL_COMPRESSED_RGB8_ETC2
+        Etc2Rgba = 0x9278, // GL_COMPRESSED_RGBA8_ETC2_EAC
+    };
+
+    // true if the internalFormat is one of the CompressedFormat
+    bool compressed() const;
+
     // raw texture data
     // it has (width * height * components * gpuTypeSize(type)) bytes
     // the rows are in no way aligned to multi-byte boundaries
     //   (GL_UNPACK_ALIGNMENT = 1)
+    // compressed textures contain 4x4 pixel blocks instead,
+    //   8 or 16 bytes each, depending on the format
     Buffer buffer;
 
+    // prepared mipmap levels following the buffer (which is level 0)
+    //   each level has half the resolution of the previous one
+    //   (rounded down, at least 1) and the same format as the buffer
+    // when empty and the filterMode requires mipmaps,
+    //   the application is expected to generate them
+    std::vector<Buffer> mipmaps;
+
     // expected size based on width * height * components * gpuTypeSize(type)
+    //   or on the number of blocks for compressed textures
     uint32 expectedSize() const;
 
     // encode the image into png format
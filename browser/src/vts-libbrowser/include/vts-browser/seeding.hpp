@@ -0,0 +1,94 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SEEDING_HPP_kl4j6g5d
+#define SEEDING_HPP_kl4j6g5d
+
+#include <memory>
+#include <atomic>
+
+#include "foundation.hpp"
+
+namespace vts
+{
+
+class SeedingTaskImpl;
+class MapImpl;
+
+// region of the map to be downloaded into the disk cache
+class VTS_API SeedingOptions
+{
+public:
+    // navigation srs (longitude and latitude in degrees
+    //   for geographic navigation srs)
+    double extentsLow[2] = { -180, -90 };
+    double extentsHigh[2] = { 180, 90 };
+
+    // inclusive range of levels of detail
+    uint32 lodMin = 0;
+    uint32 lodMax = 16;
+
+    // limit of downloads of meshes, textures and geodata
+    //   started by the seeding at the same time
+    // metatiles are downloaded by the map, see maxConcurrentDownloads
+    //   in the runtime options
+    uint32 maxConcurrentDownloads = 10;
+
+    // download textures of bound layers of the current view
+    bool boundLayers = true;
+
+    // download free layers of the current view
+    bool freeLayers = true;
+};
+
+// the seeding runs as long as the task is referenced
+//   and the map is updated (renderUpdate and dataUpdate)
+// no camera is needed
+class VTS_API SeedingTask : private Immovable
+{
+public:
+    explicit SeedingTask(const SeedingOptions &options);
+
+    const SeedingOptions options;
+
+    // progress
+    std::atomic<uint32> nodesVisited; // tiles overlapping the extents
+    std::atomic<uint32> nodesPending; // tiles not yet processed
+    std::atomic<uint32> downloadsQueued;
+    std::atomic<uint32> downloadsActive;
+    std::atomic<uint32> downloadsCached; // skipped, already in the cache
+    std::atomic<uint32> downloadsDone;
+    std::atomic<uint32> downloadsFailed;
+    std::atomic<bool> done;
+
+private:
+    std::shared_ptr<SeedingTaskImpl> impl;
+    friend MapImpl;
+};
+
+} // namespace vts
+
+#endif
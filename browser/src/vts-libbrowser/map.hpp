@@ -45,6 +45,9 @@
 
 #include "utilities/threadQueue.hpp"
 #include "validity.hpp"
+#include "resource.hpp"
+#include "resourceKey.hpp"
+#include "downloadsLimiter.hpp"
 
 #include <boost/container/small_vector.hpp>
 
@@ -60,6 +63,9 @@ class CameraImpl;
 class GpuAtmosphereDensityTexture;
 class AuthConfig;
 class SearchTask;
+class SeedingTask;
+class SeedingTaskImpl;
+class SeedingOptions;
 class GpuTexture;
 class GpuMesh;
 class MetaTile;
@@ -78,9 +84,13 @@ class Credits;
 class FetchTaskImpl;
 class GpuFont;
 class Cache;
+class MapSharedContextImpl;
 
 using TileId = vtslibs::registry::ReferenceFrame::Division::Node::Id;
 
+template<class T>
+using ResourceQueue = ThreadQueuePriority<T, const Resource *>;
+
 class CacheData
 {
 public:
@@ -89,26 +99,32 @@ public:
 
     Buffer buffer;
     std::string name;
+    std::string etag;
     sint64 expires = 0;
+    sint64 lastModified = -1;
     bool availFailed = false;
+    bool compress = false; // store compressed if it pays off
 };
 
 class UploadData
 {
 public:
     UploadData();
-    explicit UploadData(const std::shared_ptr<Resource> &resource); // upload
+    // upload, the size of the decoder input is used to estimate the cost
+    UploadData(const std::shared_ptr<Resource> &resource, uint32 size);
     explicit UploadData(std::shared_ptr<void> &userData, int); // destroy
     UploadData(const UploadData &) = delete;
     UploadData(UploadData &&) = default;
     UploadData &operator = (const UploadData &) = delete;
     UploadData &operator = (UploadData &&) = default;
 
-    void process();
+    uint32 process(); // returns the uploaded gpu memory size
+    uint32 size() const { return inputSize; }
 
 protected:
     std::weak_ptr<Resource> uploadData;
     std::shared_ptr<void> destroyData;
+    uint32 inputSize = 0;
 };
 
 class MapImpl : private Immovable
@@ -117,32 +133,38 @@ public:
     class Resources : private Immovable
     {
     public:
+        std::shared_ptr<MapSharedContextImpl> context;
         std::shared_ptr<Fetcher> fetcher;
         std::shared_ptr<Cache> cache;
         std::shared_ptr<AuthConfig> auth;
+        ResourceStates states;
+        ResourceLru lru;
         std::unordered_map<std::string, std::shared_ptr<Resource>> resources;
+        // avoids expanding url templates during traversal
+        std::unordered_map<ResourceKey, std::weak_ptr<Resource>> resourcesByKey;
         std::list<std::weak_ptr<SearchTask>> searchTasks;
+        std::list<std::shared_ptr<SeedingTaskImpl>> seedingTasks;
         std::string authPath;
         std::atomic<uint32> downloads{0}; // number of active downloads
-        std::condition_variable downloadsCondition;
+        DownloadsLimiter downloadsLimiter;
         uint32 progressEstimationMaxResources = 0;
+        // per byte of the decoder input, used by the data thread only
+        double uploadMsPerByte = 0;
+        double uploadGpuBytesPerByte = 0;
 
-        ThreadQueue<std::weak_ptr<Resource>> queFetching;
-        ThreadQueue<std::weak_ptr<Resource>> queCacheRead;
-        ThreadQueue<CacheData> queCacheWrite;
-        ThreadQueue<std::weak_ptr<Resource>> queDecode;
-        ThreadQueue<std::weak_ptr<GeodataTile>> queGeodata;
+        ResourceQueue<std::weak_ptr<Resource>> queFetching;
+        ResourceQueue<std::weak_ptr<Resource>> queCacheRead;
+        ResourceQueue<std::weak_ptr<GeodataTile>> queGeodata;
         ThreadQueue<std::weak_ptr<GpuAtmosphereDensityTexture>> queAtmosphere;
-        ThreadQueue<UploadData> queUpload;
+        ResourceQueue<UploadData> queUpload;
         std::thread thrFetcher;
-        std::thread thrCacheReader;
-        std::thread thrCacheWriter;
-        std::thread thrDecoder;
+        std::vector<std::thread> thrCacheReaders;
         std::thread thrGeodataProcessor;
         std::thread thrAtmosphereGenerator;
     } resources;
 
     Map *const map = nullptr;
+    const uint64 id = 0; // unique in the process, addresses may be reused
     const MapCreateOptions createOptions;
     MapCallbacks callbacks;
     MapStatistics statistics;
@@ -162,7 +184,7 @@ public:
 
     MapImpl(Map *map,
             const MapCreateOptions &options,
-            const std::shared_ptr<Fetcher> &fetcher);
+            const std::shared_ptr<MapSharedContextImpl> &context);
     ~MapImpl();
 
     // map api methods
@@ -187,26 +209,25 @@ public:
     // resources methods
     void resourcesDataFinalize();
     void resourcesRenderFinalize();
-    void resourcesDataUpdate();
+    void resourcesDataUpdate(double budgetMs); // zero for no time budget
     void resourcesRenderUpdate();
 
     bool resourcesTryRemove(std::shared_ptr<Resource> &r);
+    bool resourcesCancelFetch(const std::shared_ptr<FetchTaskImpl> &fetch);
+    void resourceCancelDownload(const std::shared_ptr<Resource> &r);
     void resourcesRemoveOld();
     void resourcesCheckInitialized();
     void resourcesStartDownloads();
     void resourcesDownloadsEntry();
+    void resourcesReleaseDownloadSlot(); // any thread
     void resourcesUploadProcessorEntry();
     void resourcesAtmosphereGeneratorEntry();
     void resourcesGeodataProcessorEntry();
-    void resourcesDecodeProcessorEntry();
     void resourceDecodeProcess(const std::shared_ptr<Resource> &r);
     void resourceUploadProcess(const std::shared_ptr<Resource> &r);
     void resourceSaveCorruptedFile(const std::shared_ptr<Resource> &r);
     void resourcesTerminateAllQueues();
 
-    void cacheInit();
-    void cacheWriteEntry();
-    void cacheWrite(CacheData &&data);
     void cacheReadEntry();
     void cacheReadProcess(const std::shared_ptr<Resource> &r);
     CacheData cacheRead(const std::string &name);
@@ -217,18 +238,28 @@ public:
     Validity getResourceValidity(const std::shared_ptr<Resource> &resource);
 
     std::shared_ptr<GpuTexture> getTexture(const std::string &name);
+    // the compression is set only when the texture is created
+    std::shared_ptr<GpuTexture> getTexture(const InternedUrlTemplate &url,
+        const UrlTemplate::Vars &vars,
+        TextureCompression compression = TextureCompression::None);
     std::shared_ptr<GpuAtmosphereDensityTexture>
         getAtmosphereDensityTexture(const std::string &name);
     std::shared_ptr<GpuMesh> getMesh(const std::string &name);
     std::shared_ptr<AuthConfig> getAuthConfig(const std::string &name);
     std::shared_ptr<Mapconfig> getMapconfig(const std::string &name);
     std::shared_ptr<MetaTile> getMetaTile(const std::string &name);
+    std::shared_ptr<MetaTile> getMetaTile(const InternedUrlTemplate &url,
+        const UrlTemplate::Vars &vars);
     std::shared_ptr<MeshAggregate> getMeshAggregate(const std::string &name);
+    std::shared_ptr<MeshAggregate> getMeshAggregate(
+        const InternedUrlTemplate &url, const UrlTemplate::Vars &vars);
     std::shared_ptr<ExternalBoundLayer> getExternalBoundLayer(
             const std::string &name);
     std::shared_ptr<ExternalFreeLayer> getExternalFreeLayer(
             const std::string &name);
     std::shared_ptr<BoundMetaTile> getBoundMetaTile(const std::string &name);
+    std::shared_ptr<BoundMetaTile> getBoundMetaTile(
+        const InternedUrlTemplate &url, const UrlTemplate::Vars &vars);
     std::shared_ptr<SearchTaskImpl> getSearchTask(const std::string &name);
     std::shared_ptr<TilesetMapping> getTilesetMapping(const std::string &name);
     std::shared_ptr<GeodataFeatures> getGeoFeatures(const std::string &name);
@@ -243,6 +274,9 @@ public:
     void parseSearchResults(const std::shared_ptr<SearchTask> &task);
 
     void updateSearch();
+    std::shared_ptr<SeedingTask> seed(const SeedingOptions &options);
+    void updateSeeding();
+    void purgeSeeding();
     double getMapRenderProgress();
     bool getMapRenderComplete();
     TileId roundId(TileId nodeId);
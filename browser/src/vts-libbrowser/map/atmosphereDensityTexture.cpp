@@ -31,6 +31,7 @@
 #include "../gpuResource.hpp"
 #include "../fetchTask.hpp"
 #include "../map.hpp"
+#include "../sharedContext.hpp"
 #include "../mapConfig.hpp"
 
 #include <dbglog/dbglog.hpp>
@@ -66,13 +67,29 @@ void generateAtmosphereTexture(
         res.size.width, res.size.height, res.components);
 
     // write to cache
-    tex->map->resources.queCacheWrite.push(tex->fetch.get());
+    tex->map->resources.context->queCacheWrite.push(tex->fetch.get());
 
     // mark the texture ready
     {
         tex->info.ramMemoryCost = tex->fetch->reply.content.size();
         tex->state = Resource::State::downloaded;
-        tex->map->resources.queDecode.push(tex);
+        tex->map->resources.context->queDecode.push(
+            DecodeJob(tex), tex->priority, tex.get());
+    }
+}
+
+// the pointers must not alias, which allows the compiler
+//   to vectorize the loop
+void interleave3(unsigned char *__restrict res,
+    const unsigned char *__restrict r,
+    const unsigned char *__restrict g,
+    const unsigned char *__restrict b, uint32 cnt)
+{
+    for (uint32 i = 0; i < cnt; i++)
+    {
+        res[i * 3 + 0] = r[i];
+        res[i * 3 + 1] = g[i];
+        res[i * 3 + 2] = b[i];
     }
 }
 
@@ -94,19 +111,9 @@ void gray3ToRgb(GpuTextureSpec &spec)
     const char *b = orig.data() + (spec.width * spec.height) * 2;
 
     spec.buffer.allocate(spec.width * spec.height * spec.components);
-    char *res = spec.buffer.data();
-    for (uint32 y = 0; y < spec.height; y++)
-    {
-        for (uint32 x = 0; x < spec.width; x++)
-        {
-            res[(y * spec.width + x) * spec.components + 0]
-                = r[y * spec.width + x];
-            res[(y * spec.width + x) * spec.components + 1]
-                = g[y * spec.width + x];
-            res[(y * spec.width + x) * spec.components + 2]
-                = b[y * spec.width + x];
-        }
-    }
+    interleave3((unsigned char *)spec.buffer.data(),
+        (const unsigned char *)r, (const unsigned char *)g,
+        (const unsigned char *)b, spec.width * spec.height);
 }
 
 } // namespace
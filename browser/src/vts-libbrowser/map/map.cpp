@@ -38,31 +38,43 @@
 #include "../credits.hpp"
 #include "../coordsManip.hpp"
 #include "../map.hpp"
+#include "../sharedContext.hpp"
 
 #include <optick.h>
 
+#include <algorithm>
+#include <atomic>
+
 namespace vts
 {
 
+namespace
+{
+
+std::atomic<uint64> lastMapId;
+
+} // namespace
+
 MapImpl::MapImpl(Map *map, const MapCreateOptions &options,
-    const std::shared_ptr<Fetcher> &fetcher) :
-    map(map), createOptions(options)
+    const std::shared_ptr<MapSharedContextImpl> &context) :
+    map(map), id(++lastMapId), createOptions(options)
 {
-    assert(fetcher);
-    resources.fetcher = fetcher;
+    assert(context);
+    resources.context = context;
+    resources.fetcher = context->fetcher;
+    resources.cache = context->cache;
+    context->attach(this);
     resources.thrFetcher
         = std::thread(&MapImpl::resourcesDownloadsEntry, this);
-    resources.thrCacheReader
-        = std::thread(&MapImpl::cacheReadEntry, this);
-    resources.thrCacheWriter
-        = std::thread(&MapImpl::cacheWriteEntry, this);
-    resources.thrDecoder
-        = std::thread(&MapImpl::resourcesDecodeProcessorEntry, this);
+    uint32 cacheReaders = std::max<uint32>(options.cacheReadThreads, 1);
+    resources.thrCacheReaders.reserve(cacheReaders);
+    for (uint32 i = 0; i < cacheReaders; i++)
+        resources.thrCacheReaders.push_back(
+            std::thread(&MapImpl::cacheReadEntry, this));
     resources.thrGeodataProcessor
         = std::thread(&MapImpl::resourcesGeodataProcessorEntry, this);
     resources.thrAtmosphereGenerator
         = std::thread(&MapImpl::resourcesAtmosphereGeneratorEntry, this);
-    cacheInit();
     credits = std::make_shared<Credits>();
 }
 
@@ -70,11 +82,11 @@ MapImpl::~MapImpl()
 {
     resourcesTerminateAllQueues();
     resources.thrFetcher.join();
-    resources.thrCacheReader.join();
-    resources.thrCacheWriter.join();
-    resources.thrDecoder.join();
+    for (std::thread &t : resources.thrCacheReaders)
+        t.join();
     resources.thrAtmosphereGenerator.join();
     resources.thrGeodataProcessor.join();
+    resources.context->detach(this);
 }
 
 void MapImpl::renderUpdate(double elapsedTime)
@@ -93,6 +105,7 @@ void MapImpl::renderUpdate(double elapsedTime)
     assert(layers[0]->traverseRoot);
 
     updateSearch();
+    updateSeeding();
 
     cameras.erase(std::remove_if(cameras.begin(), cameras.end(),
         [&](std::weak_ptr<CameraImpl> &camera) {
@@ -136,6 +149,7 @@ void MapImpl::purgeMapconfig()
 
     credits->purge();
     resources.searchTasks.clear();
+    purgeSeeding();
     convertor.reset();
     body = MapCelestialBody();
     purgeViewCache();
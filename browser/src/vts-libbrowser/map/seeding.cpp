@@ -0,0 +1,711 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "../include/vts-browser/log.hpp"
+
+#include "../seedingTask.hpp"
+#include "../fetchTask.hpp"
+#include "../sharedContext.hpp"
+#include "../authConfig.hpp"
+#include "../coordsManip.hpp"
+#include "../mapConfig.hpp"
+#include "../mapLayer.hpp"
+#include "../cache.hpp"
+
+#include <optick.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace vts
+{
+
+namespace
+{
+
+// the seeding yields to resources needed by cameras
+const float SeedingPriority = 1e-3f;
+
+// limits of work done in single update
+const uint32 MaxNodesPerUpdate = 1000;
+const uint32 MaxCacheChecksInFlight = 1000;
+const uint32 MaxQueuedDownloads = 10000;
+
+// the traversal pauses while too many nodes wait for their metatiles
+const uint32 MaxWaitingNodes = 1000;
+
+bool isRemote(const std::string &name)
+{
+    return name.compare(0, 7, "http://") == 0
+        || name.compare(0, 8, "https://") == 0;
+}
+
+// index of the reference division node containing the tile
+//   or -1 if there is none
+sint32 findDivisionNode(const Mapconfig *m, TileId t)
+{
+    while (true)
+    {
+        for (uint32 i = 0, e = m->referenceDivisionNodeInfos.size();
+            i < e; i++)
+        {
+            if (m->referenceDivisionNodeInfos[i].nodeId() == t)
+                return i;
+        }
+        if (t.lod == 0)
+            return -1;
+        t = vtslibs::vts::parent(t);
+    }
+}
+
+boost::optional<Extents2> convertExtents(MapImpl *map,
+    const SeedingOptions &o, const std::string &srs)
+{
+    if (srs.empty())
+        return {};
+    // sample a grid, the boundary may be curved in the target srs
+    static const uint32 Samples = 9;
+    double lo[2] = { inf1(), inf1() };
+    double hi[2] = { -inf1(), -inf1() };
+    for (uint32 y = 0; y < Samples; y++)
+    {
+        for (uint32 x = 0; x < Samples; x++)
+        {
+            vec3 p(o.extentsLow[0] + (o.extentsHigh[0] - o.extentsLow[0])
+                    * x / (Samples - 1),
+                o.extentsLow[1] + (o.extentsHigh[1] - o.extentsLow[1])
+                    * y / (Samples - 1), 0);
+            try
+            {
+                p = map->convertor->convert(p, Srs::Navigation, srs);
+            }
+            catch (...)
+            {
+                continue; // the point is outside the projection
+            }
+            for (uint32 i = 0; i < 2; i++)
+            {
+                if (!std::isfinite(p[i]))
+                    continue;
+                lo[i] = std::min(lo[i], p[i]);
+                hi[i] = std::max(hi[i], p[i]);
+            }
+        }
+    }
+    if (lo[0] > hi[0] || lo[1] > hi[1])
+        return {};
+    Extents2 r;
+    r.ll[0] = lo[0];
+    r.ll[1] = lo[1];
+    r.ur[0] = hi[0];
+    r.ur[1] = hi[1];
+    return r;
+}
+
+bool overlaps(MapImpl *map, SeedingTaskImpl *s, const TileId &id,
+    TileId &localId)
+{
+    const Mapconfig *m = map->mapconfig.get();
+    sint32 index = findDivisionNode(m, id);
+    if (index < 0)
+    {
+        localId = id;
+        return true;
+    }
+    const vtslibs::vts::NodeInfo &d = m->referenceDivisionNodeInfos[index];
+    localId = vtslibs::vts::local(d.nodeId().lod, id);
+    const boost::optional<Extents2> &se = s->divisionExtents[index];
+    if (!se)
+        return true;
+    Extents2 e = subExtents(d.extents(), d.nodeId(), id);
+    return e.ll[0] <= se->ur[0] && e.ur[0] >= se->ll[0]
+        && e.ll[1] <= se->ur[1] && e.ur[1] >= se->ll[1];
+}
+
+void queueDownload(SeedingTaskImpl *s, const std::string &name,
+    FetchTask::ResourceType type,
+    const std::shared_ptr<void> &availTest = nullptr)
+{
+    SeedingTaskImpl::Download d;
+    d.name = name;
+    d.type = type;
+    d.availTest = availTest;
+    s->downloads.push_back(std::move(d));
+}
+
+std::vector<std::string> boundIds(MapLayer *layer,
+    const SurfaceInfo *surface)
+{
+    std::vector<std::string> ids;
+    sint32 cnt = std::max<sint32>(surface->name.size(), 1);
+    for (sint32 r = 1; r <= cnt; r++)
+    {
+        for (const BoundParamInfo &b : layer->boundList(surface, r))
+        {
+            if (std::find(ids.begin(), ids.end(), b.id) == ids.end())
+                ids.push_back(b.id);
+        }
+    }
+    return ids;
+}
+
+// same as in the traversal, see CameraImpl::travDetermineMeta
+// returns false if the metatiles are not yet available
+bool processNode(MapImpl *map, SeedingTaskImpl *s,
+    const SeedingTaskImpl::Node &n)
+{
+    MapLayer *layer = n.layer.get();
+    const std::vector<SurfaceInfo> &surfaces = layer->surfaceStack.surfaces;
+
+    TileId localId;
+    if (!overlaps(map, s, n.id, localId))
+        return true;
+
+    // non-tiled geodata
+    if (layer->freeLayer && layer->freeLayer->type
+        == vtslibs::registry::FreeLayer::Type::geodata)
+    {
+        queueDownload(s, surfaces[0].urlGeodata({}),
+            FetchTask::ResourceType::GeodataFeatures);
+        return true;
+    }
+
+    // find all metatiles
+    std::vector<std::shared_ptr<MetaTile>> metaTiles(surfaces.size());
+    const UrlTemplate::Vars tileIdVars(map->roundId(n.id));
+    bool determined = true;
+    for (uint32 i = 0, e = metaTiles.size(); i != e; i++)
+    {
+        if (!n.parentMetaTiles.empty())
+        {
+            const std::shared_ptr<MetaTile> &p = n.parentMetaTiles[i];
+            if (!p)
+                continue;
+            TileId pid = vtslibs::vts::parent(n.id);
+            uint32 idx = (n.id.x % 2) + (n.id.y % 2) * 2;
+            const vtslibs::vts::MetaNode &node = p->get(pid);
+            if ((node.flags()
+                 & (vtslibs::vts::MetaNode::Flag::ulChild << idx)) == 0)
+                continue;
+        }
+        auto m = map->getMetaTile(surfaces[i].urlMeta, tileIdVars);
+        m->updatePriority(SeedingPriority);
+        switch (map->getResourceValidity(m))
+        {
+        case Validity::Indeterminate:
+            determined = false;
+            s->awaited.insert(m);
+            UTILITY_FALLTHROUGH;
+        case Validity::Invalid:
+            continue;
+        case Validity::Valid:
+            break;
+        }
+        metaTiles[i] = m;
+    }
+    if (!determined)
+        return false;
+
+    // find topmost nonempty surface
+    const SurfaceInfo *topmost = nullptr;
+    uint32 chosen = (uint32)-1;
+    bool childsAvailable[4] = {false, false, false, false};
+    for (uint32 i = 0, e = metaTiles.size(); i != e; i++)
+    {
+        if (!metaTiles[i])
+            continue;
+        const vtslibs::vts::MetaNode &node = metaTiles[i]->get(n.id);
+        for (uint32 i = 0; i < 4; i++)
+            childsAvailable[i] = childsAvailable[i]
+                    || (node.childFlags()
+                        & (vtslibs::vts::MetaNode::Flag::ulChild << i));
+        if (topmost || node.alien() != surfaces[i].alien)
+            continue;
+        if (node.geometry())
+        {
+            chosen = i;
+            if (layer->tilesetStack)
+            {
+                assert(node.sourceReference > 0 && node.sourceReference
+                       <= layer->tilesetStack->surfaces.size());
+                topmost = &layer->tilesetStack
+                        ->surfaces[node.sourceReference];
+            }
+            else
+                topmost = &surfaces[i];
+        }
+        if (chosen == (uint32)-1)
+            chosen = i;
+    }
+    if (chosen == (uint32)-1)
+        return true;
+
+    if (auto t = s->task.lock())
+        t->nodesVisited++;
+
+    // resources of the tile
+    if (topmost && n.id.lod >= s->options.lodMin)
+    {
+        const UrlTemplate::Vars vars(n.id, localId);
+        if (layer->isGeodata())
+        {
+            queueDownload(s, topmost->urlGeodata(vars),
+                FetchTask::ResourceType::GeodataFeatures);
+        }
+        else
+        {
+            queueDownload(s, topmost->urlMesh(vars),
+                FetchTask::ResourceType::Mesh);
+            const vtslibs::vts::MetaNode &node = metaTiles[chosen]->get(n.id);
+            for (uint32 i = 0, e = node.internalTextureCount(); i < e; i++)
+            {
+                queueDownload(s, topmost->urlIntTex(
+                    UrlTemplate::Vars(n.id, localId, i)),
+                    FetchTask::ResourceType::Texture);
+            }
+            // the submeshes are not decoded,
+            //   therefore all bound layers of the surface are seeded
+            if (s->options.boundLayers)
+            {
+                for (const std::string &id : boundIds(layer, topmost))
+                {
+                    SeedingTaskImpl::Bound b;
+                    b.boundId = id;
+                    b.id = n.id;
+                    b.localId = localId;
+                    s->bounds.push_back(std::move(b));
+                }
+            }
+        }
+    }
+
+    // children
+    //   pushed in reverse order to be popped in the original order
+    if (n.id.lod < s->options.lodMax)
+    {
+        vtslibs::vts::Children childs = vtslibs::vts::children(n.id);
+        for (uint32 i = 4; i-- > 0;)
+        {
+            if (!childsAvailable[i])
+                continue;
+            SeedingTaskImpl::Node c;
+            c.layer = n.layer;
+            c.id = childs[i];
+            c.parentMetaTiles = metaTiles;
+            s->nodes.push_back(std::move(c));
+        }
+    }
+
+    return true;
+}
+
+// same as in the rendering, see BoundParamInfo::prepare
+// returns false if the bound metatiles are not yet available
+bool processBound(MapImpl *map, SeedingTaskImpl *s,
+    const SeedingTaskImpl::Bound &b)
+{
+    if (!map->mapconfig->boundLayers.get(b.boundId, std::nothrow))
+        return true;
+    const BoundInfo *bound = map->mapconfig->getBoundInfo(b.boundId);
+    if (!bound)
+        return false; // external bound layer is not yet available
+
+    // check lodRange and tileRange
+    {
+        TileId t = b.id;
+        int m = bound->lodRange.min;
+        if (t.lod < m)
+            return true;
+        t.x >>= t.lod - m;
+        t.y >>= t.lod - m;
+        if (t.x < bound->tileRange.ll[0] || t.x > bound->tileRange.ur[0])
+            return true;
+        if (t.y < bound->tileRange.ll[1] || t.y > bound->tileRange.ur[1])
+            return true;
+    }
+
+    sint32 depth = std::max(b.id.lod - bound->lodRange.max, 0);
+    while (true)
+    {
+        UrlTemplate::Vars vars(b.id, b.localId);
+        vars.tileId.lod -= depth;
+        vars.tileId.x >>= depth;
+        vars.tileId.y >>= depth;
+        vars.localId.lod -= depth;
+        vars.localId.x >>= depth;
+        vars.localId.y >>= depth;
+
+        // bound meta node
+        bool available = true;
+        bool watertight = true;
+        if (bound->metaUrl)
+        {
+            UrlTemplate::Vars v(vars);
+            v.tileId.x &= ~255;
+            v.tileId.y &= ~255;
+            v.localId.x &= ~255;
+            v.localId.y &= ~255;
+            std::shared_ptr<BoundMetaTile> bmt
+                    = map->getBoundMetaTile(bound->urlMeta, v);
+            bmt->updatePriority(SeedingPriority);
+            switch (map->getResourceValidity(bmt))
+            {
+            case Validity::Indeterminate:
+                s->awaited.insert(bmt);
+                return false;
+            case Validity::Invalid:
+                available = false;
+                break;
+            case Validity::Valid:
+            {
+                using vtslibs::registry::BoundLayer;
+                uint8 f = bmt->flags[(vars.tileId.y & 255) * 256
+                        + (vars.tileId.x & 255)];
+                available = (f & BoundLayer::MetaFlags::available)
+                        == BoundLayer::MetaFlags::available;
+                watertight = (f & BoundLayer::MetaFlags::watertight)
+                        == BoundLayer::MetaFlags::watertight;
+            } break;
+            }
+        }
+
+        if (available)
+        {
+            std::string name = bound->urlExtTex(vars);
+            // coarser textures are shared by many tiles
+            if (depth == 0 || s->boundsQueued.insert(name).second)
+            {
+                // the renderer tests the color texture only
+                queueDownload(s, name, FetchTask::ResourceType::Texture,
+                    bound->availability);
+                if (!watertight)
+                {
+                    queueDownload(s, bound->urlMask(vars),
+                        FetchTask::ResourceType::Texture);
+                }
+            }
+            return true;
+        }
+        if (b.id.lod - depth <= bound->lodRange.min)
+            return true;
+        depth++;
+    }
+}
+
+void finishDownloads(MapImpl *map, SeedingTaskImpl *s, SeedingTask *t)
+{
+    auto it = s->active.begin();
+    while (it != s->active.end())
+    {
+        SeedingFetchTask *f = it->get();
+        if (!f->finished)
+        {
+            it++;
+            continue;
+        }
+        FetchTask::Reply &reply = f->reply;
+
+        // handle redirections
+        //   the requests are not conditional, 304 is an error
+        if (reply.code >= 300 && reply.code < 400 && reply.code != 304
+            && f->redirectionsCount++ <= map->options.maxFetchRedirections)
+        {
+            f->query.url.swap(reply.redirectUrl);
+            reply = FetchTask::Reply();
+            f->finished = false;
+            map->resources.context->fetcher->fetch(*it);
+            it++;
+            continue;
+        }
+
+        if (reply.code >= 200 && reply.code < 300)
+        {
+            CacheData cd;
+            cd.buffer = std::move(reply.content);
+            cd.name = f->name;
+            cd.etag = reply.etag;
+            cd.expires = reply.expires;
+            cd.lastModified = reply.lastModified;
+            // placeholders of unavailable tiles are cached as such,
+            //   same as in FetchTaskImpl::process
+            cd.availFailed = !performAvailTest(f->availTest, reply);
+            cd.compress
+                = map->resources.context->createOptions.diskCacheCompression
+                && Resource::allowDiskCompression(f->query.resourceType);
+            auto &q = map->resources.context->queCacheWrite;
+            if (q.stopped())
+                t->downloadsFailed++;
+            else
+            {
+                q.push(std::move(cd));
+                t->downloadsDone++;
+            }
+        }
+        else
+        {
+            LOG(err1) << "Error seeding <" << f->name
+                << ">, http code " << reply.code;
+            t->downloadsFailed++;
+        }
+        it = s->active.erase(it);
+    }
+}
+
+void startDownloads(MapImpl *map, SeedingTaskImpl *s, SeedingTask *t)
+{
+    // the disk cache is checked asynchronously,
+    //   only as far ahead as needed to keep the downloads busy
+    while (!s->downloads.empty()
+        && s->cacheChecking + s->missing.size() < MaxCacheChecksInFlight)
+    {
+        SeedingTaskImpl::Download d = std::move(s->downloads.front());
+        s->downloads.pop_front();
+        // local resources need no caching
+        if (!isRemote(d.name))
+        {
+            t->downloadsCached++;
+            continue;
+        }
+        s->cacheChecking++;
+        s->queCacheCheck.push(std::move(d));
+    }
+    {
+        SeedingTaskImpl::Download d;
+        while (s->queCacheChecked.tryPop(d))
+        {
+            s->cacheChecking--;
+            if (d.cached)
+                t->downloadsCached++;
+            else
+                s->missing.push_back(std::move(d));
+        }
+    }
+
+    while (!s->missing.empty()
+        && s->active.size()
+            < std::max<uint32>(s->options.maxConcurrentDownloads, 1)
+        && map->resources.context->queCacheWrite.estimateSize()
+            < map->options.maxCacheWriteQueueLength)
+    {
+        SeedingTaskImpl::Download d = std::move(s->missing.front());
+        s->missing.pop_front();
+        auto f = std::make_shared<SeedingFetchTask>(d.name, d.type);
+        f->availTest = std::move(d.availTest);
+        f->query.headers["X-Vts-Client-Id"] = map->createOptions.clientId;
+        if (map->resources.auth)
+            map->resources.auth->authorize(d.name, f->query);
+        s->active.push_back(f);
+        map->resources.context->fetcher->fetch(f);
+    }
+}
+
+void cancelDownloads(MapImpl *map, SeedingTaskImpl *s)
+{
+    for (const auto &f : s->active)
+    {
+        if (!f->finished)
+            map->resources.context->fetcher->cancel(f);
+    }
+    s->active.clear();
+    s->awaited.clear();
+    s->terminate();
+}
+
+} // namespace
+
+SeedingFetchTask::SeedingFetchTask(const std::string &name,
+    ResourceType resourceType) :
+    FetchTask(name, resourceType), name(name)
+{}
+
+void SeedingFetchTask::fetchDone()
+{
+    LOG(debug) << "Seeding <" << name << "> finished downloading, "
+        << "http code: " << reply.code;
+    finished = true;
+}
+
+SeedingTaskImpl::SeedingTaskImpl(MapImpl *map,
+    const std::shared_ptr<SeedingTask> &task) :
+    task(task), options(task->options), cache(map->resources.cache)
+{
+    const Mapconfig *m = map->mapconfig.get();
+    divisionExtents.reserve(m->referenceDivisionNodeInfos.size());
+    for (const auto &d : m->referenceDivisionNodeInfos)
+        divisionExtents.push_back(convertExtents(map, options, d.node().srs));
+    for (uint32 i = 0, e = map->layers.size(); i < e; i++)
+    {
+        if (i > 0 && !options.freeLayers)
+            break;
+        Node n;
+        n.layer = map->layers[i];
+        nodes.push_back(std::move(n));
+    }
+    thrCacheCheck = std::thread(&SeedingTaskImpl::cacheCheckEntry, this);
+}
+
+SeedingTaskImpl::~SeedingTaskImpl()
+{
+    terminate();
+    thrCacheCheck.join();
+}
+
+void SeedingTaskImpl::terminate()
+{
+    queCacheCheck.terminate();
+    queCacheChecked.terminate();
+}
+
+void SeedingTaskImpl::cacheCheckEntry()
+{
+    OPTICK_THREAD("seeding");
+    setLogThreadName("seeding");
+    while (!queCacheCheck.stopped())
+    {
+        Download d;
+        if (!queCacheCheck.waitPop(d))
+            continue;
+        d.cached = cache->contains(d.name);
+        queCacheChecked.push(std::move(d));
+    }
+}
+
+SeedingTask::SeedingTask(const SeedingOptions &options) :
+    options(options), nodesVisited(0), nodesPending(0),
+    downloadsQueued(0), downloadsActive(0), downloadsCached(0),
+    downloadsDone(0), downloadsFailed(0), done(false)
+{}
+
+std::shared_ptr<SeedingTask> MapImpl::seed(const SeedingOptions &options)
+{
+    OPTICK_EVENT();
+    if (!createOptions.diskCache)
+        LOG(warn3) << "Seeding without disk cache has no effect";
+    auto t = std::make_shared<SeedingTask>(options);
+    auto s = std::make_shared<SeedingTaskImpl>(this, t);
+    t->impl = s;
+    resources.seedingTasks.push_back(s);
+    return t;
+}
+
+void MapImpl::updateSeeding()
+{
+    OPTICK_EVENT();
+    auto it = resources.seedingTasks.begin();
+    while (it != resources.seedingTasks.end())
+    {
+        SeedingTaskImpl *s = it->get();
+        std::shared_ptr<SeedingTask> t = s->task.lock();
+        if (!t)
+        {
+            // nobody is interested anymore
+            cancelDownloads(this, s);
+            it = resources.seedingTasks.erase(it);
+            continue;
+        }
+
+        finishDownloads(this, s, t.get());
+
+        // the nodes are revisited in a round robin,
+        //   which may take longer than the resources are kept unused
+        for (auto ai = s->awaited.begin(); ai != s->awaited.end();)
+        {
+            if (getResourceValidity(*ai) != Validity::Indeterminate)
+            {
+                ai = s->awaited.erase(ai);
+                continue;
+            }
+            touchResource(*ai);
+            (*ai)->updatePriority(SeedingPriority);
+            ai++;
+        }
+
+        // traverse the tiles
+        //   nodes waiting for metatiles are retried in next update
+        for (uint32 i = 0, e = std::min<uint32>(s->waiting.size(),
+            MaxNodesPerUpdate); i < e
+            && s->downloads.size() < MaxQueuedDownloads; i++)
+        {
+            SeedingTaskImpl::Node n = std::move(s->waiting.front());
+            s->waiting.pop_front();
+            if (!processNode(this, s, n))
+                s->waiting.push_back(std::move(n));
+        }
+        for (uint32 i = 0; i < MaxNodesPerUpdate && !s->nodes.empty()
+            && s->waiting.size() < MaxWaitingNodes
+            && s->bounds.size() < MaxQueuedDownloads
+            && s->downloads.size() < MaxQueuedDownloads; i++)
+        {
+            SeedingTaskImpl::Node n = std::move(s->nodes.back());
+            s->nodes.pop_back();
+            if (!processNode(this, s, n))
+                s->waiting.push_back(std::move(n));
+        }
+        for (uint32 i = 0, e = std::min<uint32>(s->bounds.size(),
+            MaxNodesPerUpdate); i < e
+            && s->downloads.size() < MaxQueuedDownloads; i++)
+        {
+            SeedingTaskImpl::Bound b = std::move(s->bounds.front());
+            s->bounds.pop_front();
+            if (!processBound(this, s, b))
+                s->bounds.push_back(std::move(b));
+        }
+
+        startDownloads(this, s, t.get());
+
+        t->nodesPending = s->nodes.size() + s->waiting.size()
+            + s->bounds.size();
+        t->downloadsQueued = s->downloads.size()
+            + s->cacheChecking + s->missing.size();
+        t->downloadsActive = s->active.size();
+        if (s->nodes.empty() && s->waiting.empty() && s->bounds.empty()
+            && s->downloads.empty() && s->cacheChecking == 0
+            && s->missing.empty() && s->active.empty())
+        {
+            LOG(info3) << "Seeding finished, downloaded: "
+                << t->downloadsDone << ", failed: " << t->downloadsFailed
+                << ", already cached: " << t->downloadsCached;
+            t->done = true;
+            it = resources.seedingTasks.erase(it);
+            continue;
+        }
+        it++;
+    }
+}
+
+void MapImpl::purgeSeeding()
+{
+    for (const auto &s : resources.seedingTasks)
+    {
+        cancelDownloads(this, s.get());
+        auto t = s->task.lock();
+        if (t)
+            t->done = true;
+    }
+    resources.seedingTasks.clear();
+}
+
+} // namespace vts
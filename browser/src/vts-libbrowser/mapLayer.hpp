@@ -50,10 +50,10 @@ public:
     SurfaceInfo(const vtslibs::registry::FreeLayer::Geodata &surface,
         const std::string &parentPath);
 
-    UrlTemplate urlMeta;
-    UrlTemplate urlMesh;
-    UrlTemplate urlIntTex;
-    UrlTemplate urlGeodata;
+    InternedUrlTemplate urlMeta;
+    InternedUrlTemplate urlMesh;
+    InternedUrlTemplate urlIntTex;
+    InternedUrlTemplate urlGeodata;
     vtslibs::vts::TilesetIdList name;
     vec3f color {0,0,0};
     bool alien = false;
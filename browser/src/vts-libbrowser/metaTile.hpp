@@ -47,8 +47,12 @@ public:
     void decode() override;
     FetchTask::ResourceType resourceType() const override;
 
-    uint8 flags[vtslibs::registry::BoundLayer::rasterMetatileWidth
-        * vtslibs::registry::BoundLayer::rasterMetatileHeight];
+    // rasterMetatileWidth * rasterMetatileHeight flags
+    //   pointing into the decoded image
+    const uint8 *flags = nullptr;
+
+private:
+    Buffer image;
 };
 
 class MetaNode
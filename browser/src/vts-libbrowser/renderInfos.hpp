@@ -32,6 +32,7 @@
 #include <vts-libs/vts/urltemplate.hpp>
 
 #include "include/vts-browser/math.hpp"
+#include "resourceKey.hpp"
 
 namespace vts
 {
@@ -54,9 +55,9 @@ public:
 
     std::shared_ptr<vtslibs::registry::BoundLayer::Availability>
         availability;
-    UrlTemplate urlExtTex;
-    UrlTemplate urlMeta;
-    UrlTemplate urlMask;
+    InternedUrlTemplate urlExtTex;
+    InternedUrlTemplate urlMeta;
+    InternedUrlTemplate urlMask;
 };
 
 class FreeInfo : public vtslibs::registry::FreeLayer
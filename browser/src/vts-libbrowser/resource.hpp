@@ -30,6 +30,9 @@
 #include <memory>
 #include <string>
 #include <atomic>
+#include <mutex>
+#include <array>
+#include <vector>
 #include <ctime>
 
 #include "include/vts-browser/resources.hpp"
@@ -59,14 +62,45 @@ public:
         availFail,
     };
 
+    static const uint32 StatesCount = (uint32)State::availFail + 1;
+
+    // groups of resources with separate memory quotas
+    enum class MemoryType
+    {
+        textures,
+        meshes,
+        metatiles,
+        geodata,
+        fonts,
+        other,
+    };
+
+    static const uint32 MemoryTypesCount = (uint32)MemoryType::other + 1;
+
+    // assignments keep the per-state lists of the map up to date
+    class StateHolder : private Immovable
+    {
+    public:
+        explicit StateHolder(Resource *owner) : owner(owner) {}
+        StateHolder &operator = (State s);
+        operator State () const { return state; }
+
+    private:
+        Resource *const owner;
+        std::atomic<State> state {State::initializing};
+        friend class ResourceStates;
+    };
+
     explicit Resource(MapImpl *map, const std::string &name);
     virtual ~Resource();
     virtual void decode() = 0; // eg. decode an image
     virtual void upload() {} // call the resource callback
     virtual bool requiresUpload() { return false; }
     virtual FetchTask::ResourceType resourceType() const = 0;
+    virtual MemoryType memoryType() const;
     bool allowDiskCache() const;
     static bool allowDiskCache(FetchTask::ResourceType type);
+    static bool allowDiskCompression(FetchTask::ResourceType type);
     void updatePriority(float priority);
     void updateAvailability(const std::shared_ptr<void> &availTest);
     void forceRedownload();
@@ -75,7 +109,7 @@ public:
 
     const std::string name;
     MapImpl *const map = nullptr;
-    std::atomic<State> state {State::initializing};
+    StateHolder state {this};
     ResourceInfo info;
     std::shared_ptr<void> decodeData;
     std::shared_ptr<FetchTaskImpl> fetch;
@@ -83,6 +117,78 @@ public:
     uint32 retryNumber = 0;
     uint32 lastAccessTick = 0;
     float priority;
+    // set while one of the cache reader threads processes the resource
+    std::atomic<bool> cacheReading {false};
+
+    // links in the per-state list, guarded by ResourceStates
+    //   stateTracked is changed by the main thread only
+    Resource *statePrev = nullptr;
+    Resource *stateNext = nullptr;
+    uint32 stateRamCost = 0; // memory accounted in ResourceStates
+    uint32 stateGpuCost = 0;
+    MemoryType stateMemoryType = MemoryType::other;
+    bool stateTracked = false;
+
+    // links in the least recently used list, main thread only
+    Resource *lruPrev = nullptr;
+    Resource *lruNext = nullptr;
+    bool lruLinked = false;
+};
+
+// intrusive lists of resources in each state
+// only resources owned by the map are tracked,
+//   therefore the main thread may access the listed resources directly
+// memory usage of tracked resources is summed on every state change,
+//   since the costs are always set before the state is changed
+class ResourceStates : private Immovable
+{
+public:
+    typedef Resource::State State;
+    typedef Resource::MemoryType MemoryType;
+
+    ResourceStates();
+    void track(Resource *r);
+    void untrack(Resource *r);
+    void untrackAll();
+    void assign(Resource *r, State s);
+    void collect(State s, std::vector<Resource *> &out);
+    uint32 count(State s) const { return counts[(uint32)s]; }
+    uint64 ramMemoryUse() const { return ramUse; }
+    uint64 gpuMemoryUse() const { return gpuUse; }
+    uint64 memoryUse(MemoryType t) const { return typeUse[(uint32)t]; }
+
+private:
+    void link(Resource *r, State s);
+    void unlink(Resource *r, State s);
+    void account(Resource *r);
+    void unaccount(Resource *r);
+
+    std::array<Resource *, Resource::StatesCount> heads;
+    std::array<std::atomic<uint32>, Resource::StatesCount> counts;
+    std::atomic<uint64> ramUse {0};
+    std::atomic<uint64> gpuUse {0};
+    std::array<std::atomic<uint64>, Resource::MemoryTypesCount> typeUse;
+    std::mutex mut;
+};
+
+// intrusive list of resources ordered by their last access
+//   the oldest resource is at the front
+// used by the main thread only
+class ResourceLru : private Immovable
+{
+public:
+    void insert(Resource *r); // as the most recent
+    void insertAfter(Resource *r, Resource *prev); // null prev as the oldest
+    void remove(Resource *r);
+    void touch(Resource *r);
+    void clear();
+    Resource *oldest() const { return head; }
+    uint32 size() const { return count; }
+
+private:
+    Resource *head = nullptr;
+    Resource *tail = nullptr;
+    uint32 count = 0;
 };
 
 std::ostream &operator << (std::ostream &stream, Resource::State state);
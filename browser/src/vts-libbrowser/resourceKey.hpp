@@ -0,0 +1,88 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RESOURCEKEY_HPP_gh45e8wq1z
+#define RESOURCEKEY_HPP_gh45e8wq1z
+
+#include <vts-libs/registry/referenceframe.hpp>
+#include <vts-libs/vts/urltemplate.hpp>
+
+#include "include/vts-browser/foundation.hpp"
+
+namespace vts
+{
+
+using TileId = vtslibs::registry::ReferenceFrame::Division::Node::Id;
+using vtslibs::vts::UrlTemplate;
+
+// url template with an id unique within the process
+class InternedUrlTemplate : public UrlTemplate
+{
+public:
+    void parse(const std::string &str); // assigns new id
+
+    uint32 id = 0;
+};
+
+// identifies a resource without expanding the url template
+class ResourceKey
+{
+public:
+    ResourceKey(const InternedUrlTemplate &url,
+        const UrlTemplate::Vars &vars);
+    bool operator == (const ResourceKey &other) const;
+
+    TileId tileId;
+    TileId localId;
+    uint32 templateId;
+    uint32 subMesh;
+};
+
+} // namespace vts
+
+namespace std
+{
+
+template<>
+struct hash<vts::ResourceKey>
+{
+    size_t operator()(const vts::ResourceKey &x) const
+    {
+        size_t r = x.templateId;
+        r = r * 31 + x.tileId.lod;
+        r = r * 31 + x.tileId.x;
+        r = r * 31 + x.tileId.y;
+        r = r * 31 + x.localId.lod;
+        r = r * 31 + x.localId.x;
+        r = r * 31 + x.localId.y;
+        r = r * 31 + x.subMesh;
+        return r;
+    }
+};
+
+} // namespace std
+
+#endif
@@ -131,14 +131,19 @@ void AuthConfig::checkTime()
 }
 
 void AuthConfig::authorize(const std::shared_ptr<Resource> &task)
+{
+    authorize(task->name, task->fetch->query);
+}
+
+void AuthConfig::authorize(const std::string &name, FetchTask::Query &query)
 {
     if (!hostnames.empty())
     {
-        std::string h = extractUrlHost(task->name);
+        std::string h = extractUrlHost(name);
         if (hostnames.find(h) == hostnames.end())
             return;
     }
-    task->fetch->query.headers["Accept"] = std::string()
+    query.headers["Accept"] = std::string()
             + "token/" + token + ", */*";
 }
 
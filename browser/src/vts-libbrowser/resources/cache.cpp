@@ -25,7 +25,10 @@
  */
 
 #include "../include/vts-browser/mapOptions.hpp"
+#include "../include/vts-browser/log.hpp"
 #include "../map.hpp"
+#include "../cache.hpp"
+#include "../sharedContext.hpp"
 
 #include <boost/filesystem.hpp>
 #include <utility/path.hpp> // homeDir
@@ -33,6 +36,15 @@
 #include <dbglog/dbglog.hpp>
 #include <optick.h>
 
+#include <zlib.h>
+
+#include <unordered_map>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
 namespace vts
 {
 
@@ -40,12 +52,13 @@ namespace
 {
 
 static const char Magic[] = "vtscache";
-static const uint16 Version = 4;
+static const uint16 Version = 6;
 
 enum class CacheFlags : uint16
 {
     None = 0,
     AvailFailed = 1 << 0,
+    Compressed = 1 << 1,
 };
 
 struct CacheHeader
@@ -54,7 +67,9 @@ struct CacheHeader
     uint16 version;
     uint16 flags;
     uint16 nameLen;
+    uint16 etagLen; // etag follows the name
     sint64 expires;
+    sint64 lastModified;
 };
 
 char digit(unsigned char a)
@@ -65,12 +80,48 @@ char digit(unsigned char a)
     return a + '0';
 }
 
-} // namespace
+std::string cacheRoot(const MapCreateOptions &options)
+{
+    std::string root = options.cachePath;
+    if (root.empty())
+    {
+        root = utility::homeDir().string();
+        if (root.empty())
+        {
+            LOGTHROW(err3, std::runtime_error)
+                << "Invalid home dir, the cache path must be defined";
+        }
+        root += "/.cache/vts-browser/";
+    }
+    if (root.back() != '/')
+        root += "/";
+    return root;
+}
 
-class Cache
+struct IndexEntry
+{
+    std::string fileName; // only when the size of the cache is limited
+    uint64 size = 0;
+    sint64 expires = 0;
+    sint64 used = 0; // time of last read or write (ms)
+    sint64 modified = 0; // modification time of the file (s)
+};
+
+sint64 currentTimeMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// stores each resource in separate file
+// when maxSize is exceeded, expired and then least recently used files
+//   are deleted, the time of the last use is kept in the file
+//   modification time
+class FileCache : public Cache
 {
 public:
-    Cache(const MapCreateOptions &options) :
+    FileCache(const MapCreateOptions &options) :
+        maxSize((uint64)options.diskCacheMaxSizeMB * 1024 * 1024),
         disabled(!options.diskCache),
         hashes(options.hashCachePaths)
     {
@@ -80,25 +131,21 @@ public:
             LOGTHROW(err4, std::logic_error)
                 << "Disk Cache is not awailable in WASM";
 #else
-            if (root.empty())
-            {
-                root = "/home";
-                root = utility::homeDir().string();
-                if (root.empty())
-                {
-                    LOGTHROW(err3, std::runtime_error)
-                        << "Invalid home dir, the cache path must be defined";
-                }
-                root += "/.cache/vts-browser/";
-            }
-            if (root.back() != '/')
-                root += "/";
+            root = cacheRoot(options);
             LOG(info2) << "Disk cache path: <" << root << ">";
+            indexThread = std::thread(&FileCache::indexEntry, this);
 #endif
         }
     }
 
-    void write(CacheData &&cd)
+    ~FileCache()
+    {
+        indexStop = true;
+        if (indexThread.joinable())
+            indexThread.join();
+    }
+
+    void write(CacheData &&cd) override
     {
 #ifndef __EMSCRIPTEN__
         if (disabled)
@@ -107,19 +154,48 @@ public:
         try
         {
             std::string name = stripScheme(cd.name);
-            Buffer b(sizeof(CacheHeader) + name.size() + cd.buffer.size());
+            if (name.size() > 65535 || cd.etag.size() > 65535)
+                return;
+            Buffer compressed;
+            if (cd.compress)
+                compressed = Cache::compress(cd.buffer);
+            Buffer b(sizeof(CacheHeader) + name.size() + cd.etag.size());
             memset(b.data(), 0, sizeof(CacheHeader)); // initialize structure padding
             CacheHeader *h = (CacheHeader*)b.data();
             memcpy(h->magic, Magic, sizeof(Magic));
             h->version = Version;
             if (cd.availFailed)
                 h->flags |= (uint16)CacheFlags::AvailFailed;
+            if (compressed.size())
+                h->flags |= (uint16)CacheFlags::Compressed;
             h->expires = cd.expires;
+            h->lastModified = cd.lastModified;
             h->nameLen = name.size();
+            h->etagLen = cd.etag.size();
             memcpy(b.data() + sizeof(CacheHeader), name.data(), name.size());
             memcpy(b.data() + sizeof(CacheHeader) + name.size(),
-                cd.buffer.data(), cd.buffer.size());
-            writeLocalFileBuffer(convertNameToCache(name), b);
+                cd.etag.data(), cd.etag.size());
+            const Buffer *parts[2] = { &b,
+                compressed.size() ? &compressed : &cd.buffer };
+            std::string fileName = convertNameToCache(name);
+            detail::writeLocalFileBuffers(fileName, parts, 2);
+            std::vector<std::string> evicted;
+            {
+                std::lock_guard<std::mutex> lock(indexMut);
+                IndexEntry &e = index[indexKey(fileName)];
+                totalSize -= e.size;
+                e.size = b.size() + parts[1]->size();
+                e.expires = cd.expires;
+                e.used = currentTimeMs();
+                e.modified = e.used / 1000;
+                totalSize += e.size;
+                if (maxSize)
+                {
+                    e.fileName = fileName;
+                    evicted = evict();
+                }
+            }
+            removeFiles(evicted);
         }
         catch (...)
         {
@@ -128,7 +204,7 @@ public:
 #endif
     }
 
-    CacheData read(const std::string &nameParam)
+    CacheData read(const std::string &nameParam) override
     {
 #ifdef __EMSCRIPTEN__
         return {};
@@ -138,42 +214,34 @@ public:
         OPTICK_EVENT();
         std::string name = stripScheme(nameParam);
         std::string fileName = convertNameToCache(name);
-        if (!boost::filesystem::exists(fileName))
+        if (!cached(fileName))
             return {};
         try
         {
             CacheData cd;
             Buffer b = readLocalFileBuffer(fileName);
-            if (b.size() < sizeof(CacheHeader))
-                return {};
-            CacheHeader *h = (CacheHeader*)b.data();
-            if (memcmp(h->magic, Magic, sizeof(Magic)) != 0)
-                return {};
-            if (h->version != Version)
-                return {};
-            sint64 &expires = cd.expires;
-            expires = h->expires;
-            if (expires == -2)
-                return {}; // must revalidate
-            if (expires > 0 && expires < std::time(nullptr))
-                return {}; // expired
-            if (name.size() != h->nameLen)
+            if (!headerMatches(b.data(), b.size(), name))
                 return {};
-            if (b.size() < sizeof(CacheHeader) + h->nameLen)
+            const CacheHeader *h = (const CacheHeader*)b.data();
+            cd.expires = h->expires;
+            cd.lastModified = h->lastModified;
+            if (expired(cd.expires) && h->etagLen == 0
+                && cd.lastModified < 0)
                 return {};
-            if (memcmp(b.data() + sizeof(CacheHeader),
-                name.data(), h->nameLen) != 0)
+            uint32 prefix = sizeof(CacheHeader) + h->nameLen + h->etagLen;
+            if (b.size() < prefix)
                 return {};
-            uint32 size = b.size() - sizeof(CacheHeader) - h->nameLen;
-            if (size > 0)
-            {
-                cd.buffer.allocate(size);
-                memcpy(cd.buffer.data(), b.data()
-                    + sizeof(CacheHeader) + h->nameLen, size);
-            }
+            cd.etag = std::string(b.data() + sizeof(CacheHeader)
+                + h->nameLen, h->etagLen);
             cd.availFailed = (h->flags & (uint16)CacheFlags::AvailFailed)
                 == (uint16)CacheFlags::AvailFailed;
+            cd.buffer = b.view(prefix, b.size() - prefix);
+            if ((h->flags & (uint16)CacheFlags::Compressed)
+                == (uint16)CacheFlags::Compressed)
+                cd.buffer = decompress(cd.buffer);
             cd.name = nameParam;
+            if (maxSize)
+                touch(fileName, cd.expires);
             return cd;
         }
         catch (...)
@@ -183,7 +251,38 @@ public:
 #endif
     }
 
-    void purge()
+    bool contains(const std::string &nameParam) override
+    {
+#ifdef __EMSCRIPTEN__
+        return false;
+#else
+        if (disabled)
+            return false;
+        OPTICK_EVENT();
+        std::string name = stripScheme(nameParam);
+        try
+        {
+            std::string fileName = convertNameToCache(name);
+            if (!cached(fileName))
+                return false;
+            // reads just the header and the name, not the content
+            FILE *f = fopen(fileName.c_str(), "rb");
+            if (!f)
+                return false;
+            Buffer b(sizeof(CacheHeader) + name.size());
+            bool ok = fread(b.data(), b.size(), 1, f) == 1;
+            fclose(f);
+            return ok && headerMatches(b.data(), b.size(), name)
+                && !expired(((const CacheHeader*)b.data())->expires);
+        }
+        catch (...)
+        {
+            return false;
+        }
+#endif
+    }
+
+    void purge() override
     {
 #ifndef __EMSCRIPTEN__
         if (disabled)
@@ -191,6 +290,12 @@ public:
         OPTICK_EVENT();
         LOG(info2) << "Purging disk cache";
         assert(root.length() > 0 && root[root.length() - 1] == '/');
+        {
+            std::lock_guard<std::mutex> lock(indexMut);
+            index.clear();
+            totalSize = 0;
+            indexGeneration++;
+        }
         std::string op = root.substr(0, root.length() - 1);
         if (!boost::filesystem::exists(op))
             return;
@@ -236,25 +341,295 @@ public:
         }
     }
 
-    std::string stripScheme(const std::string &name)
+    static uint64 indexKey(const std::string &fileName)
     {
-        auto p = name.find("://");
-        return p == std::string::npos ? name : name.substr(p + 3);
+        return std::hash<std::string>()(fileName);
+    }
+
+    bool cached(const std::string &fileName)
+    {
+        if (indexReady)
+        {
+            // answer misses without touching the disk
+            std::lock_guard<std::mutex> lock(indexMut);
+            return index.count(indexKey(fileName)) > 0;
+        }
+        return boost::filesystem::exists(fileName);
+    }
+
+    // records use of the file for the eviction
+    void touch(const std::string &fileName, sint64 expires)
+    {
+        sint64 now = currentTimeMs();
+        {
+            std::lock_guard<std::mutex> lock(indexMut);
+            auto it = index.find(indexKey(fileName));
+            if (it == index.end())
+                return;
+            it->second.expires = expires;
+            it->second.used = now;
+            // the modification time is updated at most once per hour
+            now /= 1000;
+            if (it->second.modified + 3600 > now)
+                return;
+            it->second.modified = now;
+        }
+        try
+        {
+            boost::filesystem::last_write_time(fileName, now);
+        }
+        catch (...)
+        {
+            // do nothing
+        }
+    }
+
+    // removes entries from the index to get below the size limit
+    //   and returns names of their files to delete
+    //   expects the index mutex to be locked
+    std::vector<std::string> evict()
+    {
+        if (!indexReady || totalSize <= maxSize)
+            return {};
+        OPTICK_EVENT();
+        struct Candidate
+        {
+            uint64 key;
+            sint64 used;
+            bool expired;
+            bool operator < (const Candidate &other) const
+            {
+                if (expired != other.expired)
+                    return expired;
+                return used < other.used;
+            }
+        };
+        std::vector<Candidate> candidates;
+        candidates.reserve(index.size());
+        for (const auto &it : index)
+            candidates.push_back({ it.first, it.second.used,
+                Cache::expired(it.second.expires) });
+        std::sort(candidates.begin(), candidates.end());
+        // make some room to avoid evicting on every write
+        uint64 target = maxSize / 10 * 9;
+        std::vector<std::string> files;
+        for (const Candidate &c : candidates)
+        {
+            if (totalSize <= target)
+                break;
+            auto it = index.find(c.key);
+            totalSize -= it->second.size;
+            files.push_back(std::move(it->second.fileName));
+            index.erase(it);
+        }
+        LOG(info2) << "Disk cache evicted " << files.size() << " files";
+        return files;
+    }
+
+    static void removeFiles(const std::vector<std::string> &files)
+    {
+        for (const std::string &f : files)
+        {
+            boost::system::error_code ec;
+            boost::filesystem::remove(f, ec);
+        }
+    }
+
+    // the data start with the header followed by the name
+    static bool headerMatches(const char *data, std::size_t size,
+        const std::string &name)
+    {
+        if (size < sizeof(CacheHeader) + name.size())
+            return false;
+        const CacheHeader *h = (const CacheHeader*)data;
+        return memcmp(h->magic, Magic, sizeof(Magic)) == 0
+            && h->version == Version
+            && h->nameLen == name.size()
+            && memcmp(data + sizeof(CacheHeader),
+                name.data(), name.size()) == 0;
+    }
+
+    void indexWalk(const std::string &dir,
+        std::unordered_map<uint64, IndexEntry> &keys)
+    {
+        for (boost::filesystem::directory_iterator it(dir), e;
+            it != e && !indexStop; ++it)
+        {
+            std::string name = it->path().filename().string();
+            if (boost::filesystem::is_directory(it->status()))
+                indexWalk(dir + name + "/", keys);
+            else if (name.find("_tmp_") == std::string::npos)
+            {
+                IndexEntry &e = keys[indexKey(dir + name)];
+                if (maxSize)
+                    indexFile(dir + name, e);
+            }
+        }
+    }
+
+    // reads the size, the last use and the expiration of the file
+    static void indexFile(const std::string &fileName, IndexEntry &e)
+    {
+        boost::system::error_code ec;
+        e.fileName = fileName;
+        e.size = boost::filesystem::file_size(fileName, ec);
+        if (ec)
+            e.size = 0;
+        e.modified = boost::filesystem::last_write_time(fileName, ec);
+        if (ec)
+            e.modified = 0;
+        e.used = e.modified * 1000;
+        FILE *f = fopen(fileName.c_str(), "rb");
+        if (!f)
+            return;
+        CacheHeader h;
+        if (fread(&h, sizeof(h), 1, f) == 1
+            && memcmp(h.magic, Magic, sizeof(Magic)) == 0)
+            e.expires = h.expires;
+        fclose(f);
+    }
+
+    // collects names of all cached files
+    //   reads check the disk until the index is complete
+    void indexEntry()
+    {
+        OPTICK_THREAD("cache index");
+        setLogThreadName("cache index");
+        uint32 generation;
+        {
+            std::lock_guard<std::mutex> lock(indexMut);
+            generation = indexGeneration;
+        }
+        std::unordered_map<uint64, IndexEntry> keys;
+        try
+        {
+            if (boost::filesystem::exists(root))
+                indexWalk(root, keys);
+        }
+        catch (const std::exception &e)
+        {
+            LOG(warn2) << "Failed to index disk cache: <" << e.what() << ">";
+            return;
+        }
+        if (indexStop)
+            return;
+        std::vector<std::string> evicted;
+        {
+            std::lock_guard<std::mutex> lock(indexMut);
+            // the keys are obsolete if the cache was purged meanwhile
+            //   files written meanwhile are already in the index
+            if (generation == indexGeneration)
+                index.insert(keys.begin(), keys.end());
+            totalSize = 0;
+            for (const auto &it : index)
+                totalSize += it.second.size;
+            indexReady = true;
+            LOG(info2) << "Disk cache index contains " << index.size()
+                << " files, " << (totalSize / 1024 / 1024) << " MB";
+            if (maxSize)
+                evicted = evict();
+        }
+        removeFiles(evicted);
     }
 
     std::string root;
+    std::unordered_map<uint64, IndexEntry> index; // by hashes of file names
+    uint64 totalSize = 0;
+    const uint64 maxSize; // zero for unlimited
+    std::mutex indexMut;
+    std::thread indexThread;
+    uint32 indexGeneration = 0;
+    std::atomic<bool> indexReady {false};
+    std::atomic<bool> indexStop {false};
     bool disabled;
     bool hashes;
 };
 
-void MapImpl::cacheInit()
+} // namespace
+
+Cache::~Cache()
+{}
+
+std::shared_ptr<Cache> Cache::create(const MapCreateOptions &options)
+{
+    if (options.diskCache && options.diskCachePacked)
+    {
+#if defined(_WIN32) || defined(__EMSCRIPTEN__)
+        LOG(warn3) << "Packed disk cache is not available on this platform";
+#else
+        std::string root = cacheRoot(options) + "packed/";
+        LOG(info2) << "Packed disk cache path: <" << root << ">";
+        try
+        {
+            return createPackedCache(root,
+                (uint64)options.diskCacheMaxSizeMB * 1024 * 1024);
+        }
+        catch (const std::exception &e)
+        {
+            LOG(err3) << "Failed to open packed disk cache: <"
+                << e.what() << ">, using the regular cache instead";
+        }
+#endif
+    }
+    return std::make_shared<FileCache>(options);
+}
+
+std::string Cache::stripScheme(const std::string &name)
+{
+    auto p = name.find("://");
+    return p == std::string::npos ? name : name.substr(p + 3);
+}
+
+Buffer Cache::compress(const Buffer &raw)
+{
+    // the uncompressed size is stored in front of the zlib stream
+    if (raw.size() < 256)
+        return {};
+    uLongf size = compressBound(raw.size());
+    Buffer b(sizeof(uint32) + size);
+    uint32 rawSize = raw.size();
+    memcpy(b.data(), &rawSize, sizeof(uint32));
+    if (compress2((Bytef *)b.data() + sizeof(uint32), &size,
+        (const Bytef *)raw.data(), raw.size(), Z_BEST_SPEED) != Z_OK)
+        return {};
+    if (sizeof(uint32) + size > raw.size() * 9 / 10)
+        return {};
+    b.resize(sizeof(uint32) + size);
+    return b;
+}
+
+Buffer Cache::decompress(const Buffer &compressed)
+{
+    uint32 rawSize;
+    if (compressed.size() < sizeof(uint32))
+        LOGTHROW(err2, std::runtime_error)
+            << "Invalid compressed cache entry";
+    memcpy(&rawSize, compressed.data(), sizeof(uint32));
+    Buffer b(rawSize);
+    uLongf size = rawSize;
+    if (uncompress((Bytef *)b.data(), &size,
+        (const Bytef *)compressed.data() + sizeof(uint32),
+        compressed.size() - sizeof(uint32)) != Z_OK || size != rawSize)
+        LOGTHROW(err2, std::runtime_error)
+            << "Failed to decompress cache entry";
+    return b;
+}
+
+bool Cache::expired(sint64 expires)
+{
+    if (expires == -2)
+        return true; // must revalidate
+    return expires > 0 && expires < std::time(nullptr);
+}
+
+void MapSharedContextImpl::cacheInit()
 {
-    resources.cache = std::make_shared<Cache>(createOptions);
+    cache = Cache::create(createOptions);
 }
 
-void MapImpl::cacheWrite(CacheData &&data)
+void MapSharedContextImpl::cacheWrite(CacheData &&data)
 {
-    resources.cache->write(std::move(data));
+    cache->write(std::move(data));
 }
 
 CacheData MapImpl::cacheRead(const std::string &name)
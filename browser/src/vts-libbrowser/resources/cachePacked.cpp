@@ -0,0 +1,688 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+
+#include "../cache.hpp"
+
+#include <boost/filesystem.hpp>
+#include <utility/md5.hpp>
+#include <dbglog/dbglog.hpp>
+#include <optick.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <cstdio>
+#include <unordered_map>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <algorithm>
+
+namespace vts
+{
+
+namespace
+{
+
+static const uint32 EntryMagic = 0x4b505456;
+static const char IndexMagic[] = "vtspackedindex";
+static const uint32 IndexVersion = 5;
+static const uint32 SegmentCapacity = 64 * 1024 * 1024;
+
+enum class EntryFlags : uint16
+{
+    None = 0,
+    AvailFailed = 1 << 0,
+    Compressed = 1 << 1,
+};
+
+struct EntryHeader
+{
+    uint32 magic;
+    uint16 flags;
+    uint16 nameLen;
+    sint64 expires;
+    sint64 lastModified;
+    uint32 dataSize;
+    uint16 etagLen; // etag follows the name
+    uint16 reserved;
+};
+
+struct IndexHeader
+{
+    char magic[16];
+    uint32 version;
+    uint32 firstSegment; // older segments were collected
+};
+
+struct IndexRecord
+{
+    uint64 hash;
+    uint32 segment;
+    uint32 offset;
+    uint32 accessed; // the entry was read since written or collected
+    uint32 reserved;
+};
+
+uint32 entrySize(const EntryHeader &h)
+{
+    return sizeof(EntryHeader) + h.nameLen + h.etagLen + h.dataSize;
+}
+
+bool hasValidators(const EntryHeader &h)
+{
+    return h.etagLen > 0 || h.lastModified >= 0;
+}
+
+uint64 hashName(const std::string &name)
+{
+    unsigned char digest[16];
+    utility::md5::hash(name.data(), name.size(), (char*)digest);
+    uint64 r;
+    memcpy(&r, digest, sizeof(r));
+    return r;
+}
+
+void writeAll(int fd, const char *data, std::size_t size, off_t offset)
+{
+    while (size > 0)
+    {
+        ssize_t w = ::pwrite(fd, data, size, offset);
+        if (w <= 0)
+            LOGTHROW(err2, std::runtime_error)
+                << "Failed to write into packed cache";
+        data += w;
+        size -= w;
+        offset += w;
+    }
+}
+
+// append-only file mapped into memory in its full capacity
+//   only the first size bytes may be accessed
+class Segment : private Immovable
+{
+public:
+    explicit Segment(const std::string &path) : path(path)
+    {
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0)
+            LOGTHROW(err2, std::runtime_error)
+                << "Failed to open cache segment <" << path << ">";
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (uint64)st.st_size > SegmentCapacity)
+        {
+            ::close(fd);
+            LOGTHROW(err2, std::runtime_error)
+                << "Invalid cache segment <" << path << ">";
+        }
+        size = st.st_size;
+        void *p = mmap(nullptr, SegmentCapacity, PROT_READ,
+            MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED)
+        {
+            ::close(fd);
+            LOGTHROW(err2, std::runtime_error)
+                << "Failed to map cache segment <" << path << ">";
+        }
+        data = (const char *)p;
+    }
+
+    // the file may have been unlinked already,
+    //   the mapping stays valid until here
+    ~Segment()
+    {
+        munmap((void *)data, SegmentCapacity);
+        ::close(fd);
+    }
+
+    const std::string path;
+    std::vector<uint64> hashes; // entries written into this segment
+    const char *data = nullptr;
+    std::atomic<uint32> size {0}; // bytes written
+    int fd = -1;
+};
+
+struct Location
+{
+    uint32 segment;
+    uint32 offset;
+    bool accessed; // read since written or since last collection
+};
+
+class PackedCache : public Cache
+{
+public:
+    PackedCache(const std::string &root, uint64 maxSize) :
+        root(root), maxSize(maxSize),
+        segmentLimit(maxSize ? std::min<uint64>(std::max<uint64>(
+            maxSize / 8, 1024 * 1024), SegmentCapacity) : SegmentCapacity)
+    {
+        open();
+    }
+
+    ~PackedCache()
+    {
+        close();
+    }
+
+    void write(CacheData &&cd) override
+    {
+        OPTICK_EVENT();
+        try
+        {
+            std::string name = stripScheme(cd.name);
+            Buffer compressed;
+            if (cd.compress)
+                compressed = Cache::compress(cd.buffer);
+            const Buffer &body = compressed.size() ? compressed : cd.buffer;
+            uint32 total = sizeof(EntryHeader) + name.size()
+                + cd.etag.size() + body.size();
+            if (total > segmentLimit || name.size() > 65535
+                || cd.etag.size() > 65535)
+                return;
+            Buffer b(sizeof(EntryHeader) + name.size() + cd.etag.size());
+            EntryHeader *h = (EntryHeader *)b.data();
+            memset(h, 0, sizeof(EntryHeader)); // initialize padding
+            h->magic = EntryMagic;
+            if (cd.availFailed)
+                h->flags |= (uint16)EntryFlags::AvailFailed;
+            if (compressed.size())
+                h->flags |= (uint16)EntryFlags::Compressed;
+            h->nameLen = name.size();
+            h->expires = cd.expires;
+            h->lastModified = cd.lastModified;
+            h->dataSize = body.size();
+            h->etagLen = cd.etag.size();
+            memcpy(b.data() + sizeof(EntryHeader), name.data(), name.size());
+            memcpy(b.data() + sizeof(EntryHeader) + name.size(),
+                cd.etag.data(), cd.etag.size());
+
+            std::unique_lock<std::mutex> lock(mut);
+            if (indexFd < 0)
+                return;
+            append(hashName(name), b, body, false);
+            if (maxSize && totalSize > maxSize)
+                collect(lock);
+            if (indexRecords > index.size() * 2 + 100000)
+                compactIndex();
+        }
+        catch (...)
+        {
+            // do nothing
+        }
+    }
+
+    CacheData read(const std::string &nameParam) override
+    {
+        OPTICK_EVENT();
+        std::string name = stripScheme(nameParam);
+        uint64 hash = hashName(name);
+        std::shared_ptr<Segment> seg;
+        uint32 off = 0;
+        if (!locate(hash, seg, off))
+            return {};
+        EntryHeader h;
+        const char *p = entry(*seg, off, name, h);
+        if (!p)
+            return {};
+        if (expired(h.expires) && !hasValidators(h))
+        {
+            forget(hash, seg, off);
+            return {};
+        }
+        CacheData cd;
+        cd.expires = h.expires;
+        cd.lastModified = h.lastModified;
+        cd.etag = std::string(p + h.nameLen, h.etagLen);
+        if (h.dataSize > 0)
+        {
+            // the buffer keeps the segment mapped
+            cd.buffer = Buffer(const_cast<char *>(p + h.nameLen + h.etagLen),
+                h.dataSize, seg);
+        }
+        if ((h.flags & (uint16)EntryFlags::Compressed)
+            == (uint16)EntryFlags::Compressed)
+        {
+            try
+            {
+                cd.buffer = decompress(cd.buffer);
+            }
+            catch (const std::exception &)
+            {
+                return {};
+            }
+        }
+        cd.availFailed = (h.flags & (uint16)EntryFlags::AvailFailed)
+            == (uint16)EntryFlags::AvailFailed;
+        cd.name = nameParam;
+        return cd;
+    }
+
+    bool contains(const std::string &nameParam) override
+    {
+        OPTICK_EVENT();
+        std::string name = stripScheme(nameParam);
+        uint64 hash = hashName(name);
+        std::shared_ptr<Segment> seg;
+        uint32 off = 0;
+        if (!locate(hash, seg, off))
+            return false;
+        EntryHeader h;
+        if (!entry(*seg, off, name, h))
+            return false;
+        if (expired(h.expires))
+        {
+            if (!hasValidators(h))
+                forget(hash, seg, off);
+            return false;
+        }
+        return true;
+    }
+
+    void purge() override
+    {
+        OPTICK_EVENT();
+        LOG(info2) << "Purging packed disk cache";
+        std::lock_guard<std::mutex> lock(mut);
+        close();
+        try
+        {
+            // segments still being read remain valid until released
+            std::string op = root.substr(0, root.length() - 1);
+            std::string np = op + "-deleted";
+            boost::filesystem::rename(op, np);
+            boost::filesystem::remove_all(np);
+        }
+        catch (const std::exception &e)
+        {
+            LOG(warn3) << "Purging cache failed: <" << e.what() << ">";
+        }
+        try
+        {
+            open();
+        }
+        catch (const std::exception &e)
+        {
+            LOG(err3) << "Failed to reopen packed cache: <"
+                << e.what() << ">";
+        }
+    }
+
+private:
+    std::string segmentPath(uint32 i) const
+    {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "segment-%06u", i);
+        return root + buf;
+    }
+
+    std::string indexPath() const
+    {
+        return root + "index";
+    }
+
+    const std::shared_ptr<Segment> &segment(uint32 i) const
+    {
+        assert(i >= firstSegment && i - firstSegment < segments.size());
+        return segments[i - firstSegment];
+    }
+
+    // finds the entry in the index and marks it as accessed
+    //   the mark is stored in the index, so that it survives restarts
+    bool locate(uint64 hash, std::shared_ptr<Segment> &seg, uint32 &off)
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        auto it = index.find(hash);
+        if (it == index.end())
+            return false;
+        seg = segment(it->second.segment);
+        off = it->second.offset;
+        if (!it->second.accessed)
+        {
+            it->second.accessed = true;
+            try
+            {
+                record(hash, it->second);
+            }
+            catch (...)
+            {
+                // the mark is lost on restart only
+            }
+        }
+        return true;
+    }
+
+    // returns pointer to the name following the header
+    //   or null if the entry is invalid or belongs to another name
+    static const char *entry(const Segment &seg, uint32 off,
+        const std::string &name, EntryHeader &h)
+    {
+        uint64 size = seg.size;
+        if (off + sizeof(EntryHeader) > size)
+            return nullptr;
+        memcpy(&h, seg.data + off, sizeof(EntryHeader));
+        if (h.magic != EntryMagic || h.nameLen != name.size())
+            return nullptr;
+        if (off + entrySize(h) > size)
+            return nullptr;
+        const char *p = seg.data + off + sizeof(EntryHeader);
+        if (memcmp(p, name.data(), h.nameLen) != 0)
+            return nullptr; // hash collision
+        return p;
+    }
+
+    // lets the collector drop the expired entry
+    void forget(uint64 hash, const std::shared_ptr<Segment> &seg,
+        uint32 off)
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        auto it = index.find(hash);
+        if (it != index.end() && it->second.offset == off
+            && segment(it->second.segment) == seg)
+            it->second.accessed = false;
+    }
+
+    // expects the mutex to be locked
+    void append(uint64 hash, const Buffer &head, const Buffer &body,
+        bool accessed)
+    {
+        uint32 size = head.size() + body.size();
+        uint32 off = segments.empty() ? SegmentCapacity
+            : (segments.back()->size + 7) & ~7u;
+        if ((uint64)off + size > segmentLimit)
+        {
+            segments.push_back(std::make_shared<Segment>(
+                segmentPath(firstSegment + segments.size())));
+            off = 0;
+        }
+        Segment &s = *segments.back();
+        writeAll(s.fd, head.data(), head.size(), off);
+        writeAll(s.fd, body.data(), body.size(), off + head.size());
+        totalSize += off + size - s.size;
+        s.size = off + size;
+        s.hashes.push_back(hash);
+        Location &l = index[hash];
+        l = { firstSegment + (uint32)segments.size() - 1, off, accessed };
+        record(hash, l);
+    }
+
+    // appends the location to the index file
+    //   expects the mutex to be locked
+    void record(uint64 hash, const Location &l)
+    {
+        IndexRecord r;
+        memset(&r, 0, sizeof(r));
+        r.hash = hash;
+        r.segment = l.segment;
+        r.offset = l.offset;
+        r.accessed = l.accessed;
+        writeAll(indexFd, (const char *)&r, sizeof(r), indexSize);
+        indexSize += sizeof(r);
+        indexRecords++;
+    }
+
+    // removes the oldest segment
+    //   entries read since the last collection are moved to the newest one
+    //   expects the mutex to be locked, the lock is released while
+    //   the entries are copied out of the segment (which may page in
+    //   from the disk), the readers keep using the old entries meanwhile
+    void collect(std::unique_lock<std::mutex> &lock)
+    {
+        if (segments.size() < 2 || collecting)
+            return;
+        OPTICK_EVENT();
+        const std::shared_ptr<Segment> victim = segments.front();
+        const uint32 victimIndex = firstSegment;
+        const uint64 gen = generation;
+        struct Survivor
+        {
+            uint64 hash;
+            uint32 offset;
+            Buffer data;
+        };
+        std::vector<Survivor> survivors;
+        for (uint64 hash : victim->hashes)
+        {
+            auto it = index.find(hash);
+            if (it != index.end() && it->second.segment == victimIndex
+                && it->second.accessed)
+                survivors.push_back({ hash, it->second.offset, Buffer() });
+        }
+        collecting = true;
+
+        lock.unlock();
+        for (Survivor &s : survivors)
+        {
+            uint32 off = s.offset;
+            if (off + sizeof(EntryHeader) > victim->size)
+                continue;
+            EntryHeader h;
+            memcpy(&h, victim->data + off, sizeof(EntryHeader));
+            uint32 total = entrySize(h);
+            if (h.magic != EntryMagic || off + total > victim->size
+                || (expired(h.expires) && !hasValidators(h)))
+                continue;
+            s.data = Buffer(total);
+            memcpy(s.data.data(), victim->data + off, total);
+        }
+        lock.lock();
+
+        collecting = false;
+        if (generation != gen)
+            return; // the cache was purged meanwhile
+        uint32 moved = 0, dropped = 0;
+        for (Survivor &s : survivors)
+        {
+            auto it = index.find(s.hash);
+            if (s.data.size() == 0 || it == index.end()
+                || it->second.segment != victimIndex
+                || it->second.offset != s.offset)
+                continue; // invalid or overwritten meanwhile
+            append(s.hash, s.data, Buffer(), false);
+            moved++;
+        }
+        for (uint64 hash : victim->hashes)
+        {
+            auto it = index.find(hash);
+            if (it != index.end() && it->second.segment == victimIndex)
+            {
+                index.erase(it);
+                dropped++;
+            }
+        }
+        totalSize -= victim->size;
+        segments.pop_front();
+        firstSegment++;
+        writeHeader();
+        // readers holding the segment keep the mapping
+        ::unlink(victim->path.c_str());
+        LOG(info1) << "Packed cache collected segment, "
+            << moved << " entries moved, "
+            << dropped << " entries dropped";
+    }
+
+    // expects the mutex to be locked
+    void writeHeader()
+    {
+        IndexHeader h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, IndexMagic, sizeof(IndexMagic));
+        h.version = IndexVersion;
+        h.firstSegment = firstSegment;
+        writeAll(indexFd, (const char *)&h, sizeof(h), 0);
+    }
+
+    // rewrites the index without overwritten and collected records
+    //   expects the mutex to be locked
+    void compactIndex()
+    {
+        OPTICK_EVENT();
+        Buffer b(sizeof(IndexHeader) + index.size() * sizeof(IndexRecord));
+        IndexHeader *h = (IndexHeader *)b.data();
+        memset(h, 0, sizeof(IndexHeader));
+        memcpy(h->magic, IndexMagic, sizeof(IndexMagic));
+        h->version = IndexVersion;
+        h->firstSegment = firstSegment;
+        IndexRecord *r = (IndexRecord *)(b.data() + sizeof(IndexHeader));
+        memset(r, 0, index.size() * sizeof(IndexRecord));
+        for (const auto &it : index)
+        {
+            r->hash = it.first;
+            r->segment = it.second.segment;
+            r->offset = it.second.offset;
+            r->accessed = it.second.accessed;
+            r++;
+        }
+        writeLocalFileBuffer(indexPath(), b);
+        ::close(indexFd);
+        indexFd = ::open(indexPath().c_str(), O_RDWR);
+        if (indexFd < 0)
+            LOGTHROW(err2, std::runtime_error)
+                << "Failed to reopen cache index";
+        indexSize = b.size();
+        indexRecords = index.size();
+    }
+
+    void reset()
+    {
+        segments.clear();
+        boost::filesystem::remove_all(root);
+        boost::filesystem::create_directories(root);
+        indexFd = ::open(indexPath().c_str(), O_RDWR | O_CREAT, 0644);
+        if (indexFd < 0)
+            LOGTHROW(err2, std::runtime_error)
+                << "Failed to open cache index <" << indexPath() << ">";
+        firstSegment = 0;
+        writeHeader();
+        indexSize = sizeof(IndexHeader);
+    }
+
+    void open()
+    {
+        assert(root.length() > 0 && root[root.length() - 1] == '/');
+        boost::filesystem::create_directories(root);
+
+        // index
+        Buffer b;
+        if (boost::filesystem::exists(indexPath()))
+            b = readLocalFileBuffer(indexPath());
+        const IndexHeader *h = (const IndexHeader *)b.data();
+        if (b.size() < sizeof(IndexHeader)
+            || memcmp(h->magic, IndexMagic, sizeof(IndexMagic)) != 0
+            || h->version != IndexVersion)
+        {
+            if (b.size() > 0)
+                LOG(warn3) << "Packed cache index is invalid, "
+                    "the cache will be emptied";
+            reset();
+            return;
+        }
+        firstSegment = h->firstSegment;
+        indexFd = ::open(indexPath().c_str(), O_RDWR);
+        if (indexFd < 0)
+            LOGTHROW(err2, std::runtime_error)
+                << "Failed to open cache index <" << indexPath() << ">";
+
+        // segments
+        for (uint32 i = firstSegment;
+            boost::filesystem::exists(segmentPath(i)); i++)
+        {
+            segments.push_back(std::make_shared<Segment>(segmentPath(i)));
+            totalSize += segments.back()->size;
+        }
+
+        // later records override older ones
+        uint32 cnt = (b.size() - sizeof(IndexHeader)) / sizeof(IndexRecord);
+        index.reserve(cnt);
+        for (uint32 i = 0; i < cnt; i++)
+        {
+            IndexRecord r;
+            memcpy(&r, b.data() + sizeof(IndexHeader)
+                + i * sizeof(IndexRecord), sizeof(r));
+            if (r.segment < firstSegment
+                || r.segment - firstSegment >= segments.size())
+                continue;
+            auto it = index.find(r.hash);
+            if (it == index.end() || it->second.segment != r.segment
+                || it->second.offset != r.offset)
+                segment(r.segment)->hashes.push_back(r.hash);
+            index[r.hash] = { r.segment, r.offset, r.accessed != 0 };
+        }
+        indexRecords = cnt;
+
+        // drop partially written record
+        indexSize = sizeof(IndexHeader) + cnt * sizeof(IndexRecord);
+        if (indexSize != b.size() && ftruncate(indexFd, indexSize) != 0)
+            LOGTHROW(err2, std::runtime_error)
+                << "Failed to repair cache index";
+        LOG(info2) << "Packed cache contains " << index.size()
+            << " entries in " << segments.size() << " segments, "
+            << (totalSize / 1024 / 1024) << " MB";
+    }
+
+    void close()
+    {
+        generation++;
+        index.clear();
+        segments.clear();
+        if (indexFd >= 0)
+            ::close(indexFd);
+        indexFd = -1;
+        indexSize = 0;
+        indexRecords = 0;
+        totalSize = 0;
+    }
+
+    const std::string root;
+    const uint64 maxSize; // zero for unlimited
+    const uint32 segmentLimit; // size at which new segment is started
+    std::unordered_map<uint64, Location> index;
+    std::deque<std::shared_ptr<Segment>> segments;
+    uint64 totalSize = 0; // sum of sizes of all segments
+    uint64 indexSize = 0;
+    uint64 indexRecords = 0;
+    uint32 firstSegment = 0;
+    uint32 generation = 0; // changed whenever the cache is closed
+    int indexFd = -1;
+    bool collecting = false;
+    std::mutex mut;
+};
+
+} // namespace
+
+std::shared_ptr<Cache> createPackedCache(const std::string &root,
+    uint64 maxSize)
+{
+    return std::make_shared<PackedCache>(root, maxSize);
+}
+
+} // namespace vts
+
+#endif // !_WIN32 && !__EMSCRIPTEN__
@@ -0,0 +1,152 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "../include/vts-browser/mapOptions.hpp"
+
+#include "../downloadsLimiter.hpp"
+
+#include <algorithm>
+
+namespace vts
+{
+
+namespace
+{
+
+// estimated number of queued requests to keep
+const double QueuedLow = 2;
+const double QueuedHigh = 6;
+
+} // namespace
+
+void DownloadsLimiter::finished(Clock::time_point started, uint32 bytes)
+{
+    Clock::time_point now = Clock::now();
+    double latency = std::chrono::duration<double, std::milli>(
+        now - started).count();
+    std::lock_guard<std::mutex> lock(mut);
+
+    // throughput and rate of downloads
+    throughputBytes += bytes;
+    throughputCount++;
+    double elapsed = std::chrono::duration<double>(
+        now - throughputStart).count();
+    if (elapsed > 10)
+    {
+        // first download or after a long inactivity
+        throughputBytes = 0;
+        throughputCount = 0;
+        throughputStart = now;
+    }
+    else if (elapsed >= 1)
+    {
+        double t = throughputBytes / elapsed;
+        double r = throughputCount / elapsed;
+        if (throughputAvg == 0)
+        {
+            throughputAvg = t;
+            rateAvg = r;
+        }
+        else
+        {
+            throughputAvg += (t - throughputAvg) * 0.3;
+            rateAvg += (r - rateAvg) * 0.3;
+        }
+        // the link capacity, the route may change over time
+        throughputMax = std::max(throughputMax * 0.95, t);
+        throughputBytes = 0;
+        throughputCount = 0;
+        throughputStart = now;
+    }
+
+    // latency
+    //   large bodies take longer without any queueing
+    if (latencyAvg == 0)
+        latencyAvg = latency;
+    else
+        latencyAvg += (latency - latencyAvg) * 0.1;
+    double delay = latency;
+    if (throughputMax > 0)
+        delay = std::max(delay - bytes * 1000 / throughputMax, 0.0);
+    if (delayAvg == 0)
+        delayAvg = delay;
+    else
+        delayAvg += (delay - delayAvg) * 0.1;
+    // lowest delay over the last 10 to 20 seconds
+    //   the route may change over time
+    if (std::chrono::duration<double>(now - delayBaseStart).count() > 10)
+    {
+        delayBasePrev = delayBaseCur;
+        delayBaseCur = delay;
+        delayBaseStart = now;
+    }
+    else
+        delayBaseCur = std::min(delayBaseCur, delay);
+    double delayBase = delayBasePrev > 0
+        ? std::min(delayBasePrev, delayBaseCur) : delayBaseCur;
+
+    // window
+    if (window == 0 || rateAvg == 0)
+        return;
+    double queued = rateAvg * std::max(delayAvg - delayBase, 0.0) / 1000;
+    if (queued < QueuedLow)
+        window += 1 / window;
+    else if (queued > QueuedHigh
+        && std::chrono::duration<double, std::milli>(
+            now - lastDecrease).count() > latencyAvg)
+    {
+        // at most once per round trip
+        window *= 0.75;
+        lastDecrease = now;
+    }
+    window = std::min(std::max(window, windowMin), windowMax);
+}
+
+uint32 DownloadsLimiter::limit(const MapRuntimeOptions &options)
+{
+    uint32 maximum = std::max(options.maxConcurrentDownloads, 1u);
+    if (!options.adaptiveConcurrentDownloads)
+        return maximum;
+    uint32 minimum = std::min(std::max(options.minConcurrentDownloads, 1u),
+        maximum);
+    std::lock_guard<std::mutex> lock(mut);
+    windowMin = minimum;
+    windowMax = maximum;
+    if (window == 0)
+        window = minimum; // slow start
+    window = std::min(std::max(window, windowMin), windowMax);
+    return (uint32)window;
+}
+
+void DownloadsLimiter::statistics(uint32 &latencyMs,
+    uint32 &throughputKBps) const
+{
+    std::lock_guard<std::mutex> lock(mut);
+    latencyMs = (uint32)latencyAvg;
+    throughputKBps = (uint32)(throughputAvg / 1024);
+}
+
+} // namespace vts
@@ -43,6 +43,9 @@ void Fetcher::finalize()
 void Fetcher::update()
 {}
 
+void Fetcher::cancel(const std::shared_ptr<FetchTask> &)
+{}
+
 FetchTask::Query::Query(const std::string &url,
                         FetchTask::ResourceType resourceType) :
     url(url), resourceType(resourceType)
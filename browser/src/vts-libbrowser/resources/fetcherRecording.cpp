@@ -0,0 +1,412 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "../include/vts-browser/fetcher.hpp"
+#include "../include/vts-browser/buffer.hpp"
+#include "../include/vts-browser/log.hpp"
+
+#include <dbglog/dbglog.hpp>
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <map>
+#include <random>
+#include <iomanip>
+#include <sstream>
+
+namespace vts
+{
+
+namespace
+{
+
+// one file per url, named by hash of the url
+//   RecordHeader, url, content type, redirect url, etag,
+//   request headers, body
+const char RecordMagic[8] = { 'v', 't', 's', 'r', 'e', 'c', '0', '1' };
+
+struct RecordHeader
+{
+    char magic[8];
+    sint64 expires;
+    sint64 lastModified;
+    uint32 code;
+    uint32 latency; // ms
+    uint32 urlLen;
+    uint32 contentTypeLen;
+    uint32 redirectUrlLen;
+    uint32 etagLen;
+    uint32 headersLen;
+    uint32 bodySize;
+};
+
+uint64 hashUrl(const std::string &url)
+{
+    // fnv-1a, stable across platforms
+    uint64 h = 14695981039346656037ull;
+    for (char c : url)
+    {
+        h ^= (unsigned char)c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+std::string recordPath(const std::string &root, const std::string &url)
+{
+    std::ostringstream ss;
+    ss << root << "/" << std::hex << std::setw(16) << std::setfill('0')
+        << hashUrl(url) << ".rec";
+    return ss.str();
+}
+
+typedef std::chrono::steady_clock Clock;
+
+////////////////////////////
+// RECORDER
+////////////////////////////
+
+class RecordingFetcher;
+
+class RecordingTask : public FetchTask
+{
+public:
+    RecordingTask(RecordingFetcher *fetcher,
+        const std::shared_ptr<FetchTask> &task) :
+        FetchTask(task->query), fetcher(fetcher), task(task),
+        begin(Clock::now())
+    {}
+
+    void fetchDone() override;
+
+    RecordingFetcher *const fetcher;
+    const std::shared_ptr<FetchTask> task;
+    const Clock::time_point begin;
+};
+
+class RecordingFetcher : public Fetcher
+{
+public:
+    RecordingFetcher(const FetcherOptions &options,
+        const std::shared_ptr<Fetcher> &fetcher) :
+        root(options.recordPath), fetcher(fetcher)
+    {
+        assert(fetcher);
+        boost::filesystem::create_directories(root);
+        LOG(info3) << "Recording downloads into <" << root << ">";
+    }
+
+    void initialize() override
+    {
+        fetcher->initialize();
+    }
+
+    void finalize() override
+    {
+        fetcher->finalize();
+    }
+
+    void update() override
+    {
+        fetcher->update();
+    }
+
+    void fetch(const std::shared_ptr<FetchTask> &task) override
+    {
+        auto t = std::make_shared<RecordingTask>(this, task);
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            tasks[task.get()] = t;
+        }
+        fetcher->fetch(t);
+    }
+
+    void cancel(const std::shared_ptr<FetchTask> &task) override
+    {
+        std::shared_ptr<RecordingTask> t;
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            auto it = tasks.find(task.get());
+            if (it == tasks.end())
+                return;
+            t = it->second;
+        }
+        fetcher->cancel(t);
+    }
+
+    void record(RecordingTask *t)
+    {
+        const FetchTask::Reply &r = t->reply;
+        if (r.code == 0 || r.code >= 10000)
+            return; // cancellations and internal errors
+        // the records are keyed by the url only,
+        //   a reply to a conditional request must not replace
+        //   the complete reply recorded earlier
+        const auto &hs = t->query.headers;
+        bool conditional = hs.count("If-None-Match")
+            || hs.count("If-Modified-Since");
+        if (r.code == 304 || (conditional
+            && (r.code < 200 || r.code >= 300)))
+            return;
+        std::string headers;
+        for (const auto &it : t->query.headers)
+            headers += it.first + ": " + it.second + "\n";
+        const std::string &url = t->query.url;
+        Buffer head(sizeof(RecordHeader) + url.size()
+            + r.contentType.size() + r.redirectUrl.size()
+            + r.etag.size() + headers.size());
+        RecordHeader h;
+        memcpy(h.magic, RecordMagic, sizeof(RecordMagic));
+        h.expires = r.expires;
+        h.lastModified = r.lastModified;
+        h.code = r.code;
+        h.latency = std::chrono::duration_cast<std::chrono::milliseconds>(
+            Clock::now() - t->begin).count();
+        h.urlLen = url.size();
+        h.contentTypeLen = r.contentType.size();
+        h.redirectUrlLen = r.redirectUrl.size();
+        h.etagLen = r.etag.size();
+        h.headersLen = headers.size();
+        h.bodySize = r.content.size();
+        char *p = head.data();
+        memcpy(p, &h, sizeof(h));
+        p += sizeof(h);
+        const std::string *fields[] = { &url, &r.contentType,
+            &r.redirectUrl, &r.etag, &headers };
+        for (const std::string *s : fields)
+        {
+            memcpy(p, s->data(), s->size());
+            p += s->size();
+        }
+        const Buffer *buffers[2] = { &head, &r.content };
+        try
+        {
+            detail::writeLocalFileBuffers(recordPath(root, url), buffers, 2);
+        }
+        catch (const std::exception &e)
+        {
+            LOG(err2) << "Failed to record <" << url << ">: " << e.what();
+        }
+    }
+
+    const std::string root;
+    const std::shared_ptr<Fetcher> fetcher;
+    std::unordered_map<FetchTask *, std::shared_ptr<RecordingTask>> tasks;
+    std::mutex mut;
+};
+
+void RecordingTask::fetchDone()
+{
+    {
+        std::lock_guard<std::mutex> lock(fetcher->mut);
+        fetcher->tasks.erase(task.get());
+    }
+    fetcher->record(this);
+    Reply &r = task->reply;
+    r.contentType = reply.contentType;
+    r.redirectUrl = reply.redirectUrl;
+    r.expires = reply.expires;
+    r.etag = reply.etag;
+    r.lastModified = reply.lastModified;
+    r.code = reply.code;
+    r.content = std::move(reply.content);
+    task->fetchDone();
+}
+
+////////////////////////////
+// REPLAY
+////////////////////////////
+
+class ReplayFetcher : public Fetcher
+{
+public:
+    explicit ReplayFetcher(const FetcherOptions &options) :
+        options(options), linkFree(Clock::now())
+    {
+        LOG(info3) << "Replaying downloads from <"
+            << options.replayPath << ">";
+        thr = std::thread(&ReplayFetcher::entry, this);
+    }
+
+    ~ReplayFetcher()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            stop = true;
+        }
+        con.notify_all();
+        thr.join();
+    }
+
+    void fetch(const std::shared_ptr<FetchTask> &task) override
+    {
+        assert(task->reply.code == 0);
+        uint32 latency = 0;
+        uint32 size = load(task, latency);
+        std::lock_guard<std::mutex> lock(mut);
+        double ms = latency * options.replayLatencyScale
+            + options.replayLatencyExtra;
+        if (options.replayLatencyJitter)
+        {
+            ms += std::uniform_int_distribution<uint32>(
+                0, options.replayLatencyJitter)(random);
+        }
+        Clock::time_point t = Clock::now()
+            + std::chrono::microseconds(sint64(ms * 1000));
+        if (options.replayBandwidth)
+        {
+            // all downloads share single link
+            t = std::max(t, linkFree) + std::chrono::microseconds(
+                sint64(size * 1e6 / options.replayBandwidth));
+            linkFree = t;
+        }
+        queue.emplace(t, task);
+        con.notify_all();
+    }
+
+    void cancel(const std::shared_ptr<FetchTask> &task) override
+    {
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            auto it = std::find_if(queue.begin(), queue.end(),
+                [&](const std::pair<const Clock::time_point,
+                    std::shared_ptr<FetchTask>> &p) {
+                    return p.second == task;
+                });
+            if (it == queue.end())
+                return;
+            queue.erase(it);
+        }
+        task->reply = FetchTask::Reply();
+        task->reply.code = FetchTask::ExtraCodes::Cancelled;
+        task->fetchDone();
+    }
+
+private:
+    // fills in the reply, returns the body size
+    uint32 load(const std::shared_ptr<FetchTask> &task, uint32 &latency)
+    {
+        FetchTask::Reply &r = task->reply;
+        const std::string &url = task->query.url;
+        std::string path = recordPath(options.replayPath, url);
+        try
+        {
+            if (!boost::filesystem::exists(path))
+                throw std::runtime_error("not recorded");
+            Buffer b = readLocalFileBuffer(path);
+            RecordHeader h;
+            if (b.size() < sizeof(h))
+                throw std::runtime_error("truncated record");
+            memcpy(&h, b.data(), sizeof(h));
+            if (memcmp(h.magic, RecordMagic, sizeof(RecordMagic)) != 0)
+                throw std::runtime_error("invalid record");
+            uint64 prefix = uint64(sizeof(h)) + h.urlLen
+                + h.contentTypeLen + h.redirectUrlLen + h.etagLen
+                + h.headersLen;
+            if (b.size() != prefix + h.bodySize)
+                throw std::runtime_error("truncated record");
+            const char *p = b.data() + sizeof(h);
+            if (std::string(p, h.urlLen) != url)
+                throw std::runtime_error("not recorded"); // hash collision
+            p += h.urlLen;
+            r.contentType = std::string(p, h.contentTypeLen);
+            p += h.contentTypeLen;
+            r.redirectUrl = std::string(p, h.redirectUrlLen);
+            p += h.redirectUrlLen;
+            r.etag = std::string(p, h.etagLen);
+            r.expires = h.expires;
+            r.lastModified = h.lastModified;
+            r.code = h.code;
+            r.content = b.view(prefix, h.bodySize);
+            latency = h.latency;
+            return h.bodySize;
+        }
+        catch (const std::exception &e)
+        {
+            LOG(warn2) << "Replay of <" << url << "> failed: " << e.what();
+            r = FetchTask::Reply();
+            r.code = 404;
+            return 0;
+        }
+    }
+
+    void entry()
+    {
+        setLogThreadName("replay fetcher");
+        std::unique_lock<std::mutex> lock(mut);
+        while (!stop)
+        {
+            if (queue.empty())
+            {
+                con.wait(lock);
+                continue;
+            }
+            auto it = queue.begin();
+            if (it->first > Clock::now())
+            {
+                con.wait_until(lock, it->first);
+                continue;
+            }
+            std::shared_ptr<FetchTask> t = std::move(it->second);
+            queue.erase(it);
+            lock.unlock();
+            t->fetchDone();
+            lock.lock();
+        }
+    }
+
+    const FetcherOptions options;
+    std::multimap<Clock::time_point, std::shared_ptr<FetchTask>> queue;
+    Clock::time_point linkFree;
+    std::mt19937 random;
+    std::mutex mut;
+    std::condition_variable con;
+    std::thread thr;
+    bool stop = false;
+};
+
+} // namespace
+
+std::shared_ptr<Fetcher> Fetcher::createRecorder(
+    const FetcherOptions &options,
+    const std::shared_ptr<Fetcher> &fetcher)
+{
+    return std::make_shared<RecordingFetcher>(options, fetcher);
+}
+
+std::shared_ptr<Fetcher> Fetcher::createReplay(
+    const FetcherOptions &options)
+{
+    return std::make_shared<ReplayFetcher>(options);
+}
+
+} // namespace vts
@@ -2405,7 +2405,9 @@ void MapImpl::resourcesGeodataProcessorEntry()
         {
             r->decode();
             r->state = Resource::State::decoded;
-            resources.queUpload.push(UploadData(r));
+            resources.queUpload.push(UploadData(r,
+                r->features ? r->features->size() : 0),
+                r->priority, r.get());
         }
         catch (const std::exception &)
         {
@@ -242,7 +242,7 @@ GeodataTile::~GeodataTile()
         if (it.userData)
         {
             map->resources.queUpload.push(
-                UploadData(it.userData, 0));
+                UploadData(it.userData, 0), inf1());
         }
     }
 }
@@ -276,7 +276,8 @@ void GeodataTile::update(
             tileId = tid;
             state = Resource::State::downloaded;
             map->resources.queGeodata.push(
-                std::dynamic_pointer_cast<GeodataTile>(shared_from_this()));
+                std::dynamic_pointer_cast<GeodataTile>(shared_from_this()),
+                priority, this);
             return;
         }
         break;
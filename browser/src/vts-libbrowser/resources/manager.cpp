@@ -28,6 +28,8 @@
 
 #include "../fetchTask.hpp"
 #include "../map.hpp"
+#include "../cache.hpp"
+#include "../sharedContext.hpp"
 #include "../authConfig.hpp"
 #include "../utilities/dataUrl.hpp"
 
@@ -35,6 +37,8 @@
 
 #include <thread>
 #include <chrono>
+#include <ctime>
+#include <cstdio>
 
 namespace vts
 {
@@ -62,30 +66,26 @@ void MapImpl::resourceSaveCorruptedFile(const std::shared_ptr<Resource> &r)
 namespace
 {
 
-typedef std::pair<float, std::shared_ptr<Resource>> ResourceWithPriority;
+std::shared_ptr<Resource> acceptResource(const std::weak_ptr<Resource> &w,
+    Resource::State requiredState)
+{
+    std::shared_ptr<Resource> r = w.lock();
+    if (!r || r->state != requiredState)
+        return {};
+    // let the priority be refreshed by the traversal
+    if (r->priority < inf1())
+        r->priority = 0;
+    return r;
+}
 
-std::vector<ResourceWithPriority> filterSortResources(
-    const std::vector<std::weak_ptr<Resource>> &resources,
+std::shared_ptr<Resource> popResource(
+    ResourceQueue<std::weak_ptr<Resource>> &queue,
     Resource::State requiredState)
 {
-    std::vector<ResourceWithPriority> res;
-    for (const auto &w : resources)
-    {
-        std::shared_ptr<Resource> r = w.lock();
-        if (r)
-        {
-            if (r->state != requiredState)
-                continue;
-            res.emplace_back(r->priority, r);
-            if (r->priority < inf1())
-                r->priority = 0;
-        }
-    }
-    std::sort(res.begin(), res.end(),
-        [](ResourceWithPriority &a, ResourceWithPriority &b) {
-            return a.first > b.first; // highest priority first
-        });
-    return res;
+    std::weak_ptr<Resource> w;
+    if (!queue.waitPop(w))
+        return {};
+    return acceptResource(w, requiredState);
 }
 
 } // namespace
@@ -93,8 +93,8 @@ std::vector<ResourceWithPriority> filterSortResources(
 UploadData::UploadData()
 {}
 
-UploadData::UploadData(const std::shared_ptr<Resource> &resource)
-    : uploadData(resource)
+UploadData::UploadData(const std::shared_ptr<Resource> &resource,
+    uint32 size) : uploadData(resource), inputSize(size)
 {}
 
 UploadData::UploadData(std::shared_ptr<void> &userData, int)
@@ -102,12 +102,14 @@ UploadData::UploadData(std::shared_ptr<void> &userData, int)
     std::swap(userData, destroyData);
 }
 
-void UploadData::process()
+uint32 UploadData::process()
 {
     destroyData.reset();
     auto r = uploadData.lock();
-    if (r)
-        r->map->resourceUploadProcess(r);
+    if (!r)
+        return 0;
+    r->map->resourceUploadProcess(r);
+    return r->info.gpuMemoryCost;
 }
 
 ////////////////////////////
@@ -116,9 +118,11 @@ void UploadData::process()
 
 CacheData::CacheData(FetchTaskImpl *task, bool availFailed) :
     //availTest(task->availTest),
-    buffer(task->reply.content.copy()),
-    name(task->name), expires(task->reply.expires),
-    availFailed(availFailed)
+    buffer(task->reply.content.share()),
+    name(task->name), etag(task->reply.etag), expires(task->reply.expires),
+    lastModified(task->reply.lastModified), availFailed(availFailed),
+    compress(task->map->resources.context->createOptions.diskCacheCompression
+        && Resource::allowDiskCompression(task->query.resourceType))
 {}
 
 void FetchTaskImpl::fetchDone()
@@ -129,10 +133,51 @@ void FetchTaskImpl::fetchDone()
         << reply.contentType << ">, size: " << reply.content.size()
         << ", expires: " << reply.expires;
     assert(map);
-    map->resources.downloads--;
-    map->resources.downloadsCondition.notify_one();
+    // the reply may arrive from the fetcher threads while the map
+    //   is being destroyed, the map is detached only after we are done
+    const std::shared_ptr<MapSharedContextImpl> ctx = context.lock();
+    if (!ctx || !ctx->acquire(mapId))
+        return; // the map is gone
+    if (!finished.exchange(true))
+        process();
+    // else the download was cancelled
+    ctx->release(mapId);
+}
+
+void FetchTaskImpl::process()
+{
+    map->resources.downloadsLimiter.finished(started, reply.content.size());
+    map->resourcesReleaseDownloadSlot();
     Resource::State state = Resource::State::downloading;
 
+    // the server confirmed that the expired cache entry is still valid
+    std::shared_ptr<CacheData> revalidated;
+    revalidated.swap(stale);
+    if (revalidated && reply.code == 304)
+    {
+        reply.content = std::move(revalidated->buffer);
+        if (reply.etag.empty())
+            reply.etag = revalidated->etag;
+        if (reply.lastModified < 0)
+            reply.lastModified = revalidated->lastModified;
+        reply.code = 200;
+        map->statistics.resourcesRevalidated++;
+    }
+    else
+    {
+        revalidated.reset();
+        if (reply.code == 304)
+        {
+            // there is no cached content to use,
+            //   the resource is requested again without validators
+            LOG(warn2) << "Unexpected http code 304 for <"
+                << name << ">, no cached content to revalidate";
+            query.headers.erase("If-None-Match");
+            query.headers.erase("If-Modified-Since");
+            state = Resource::State::errorRetry;
+        }
+    }
+
     // handle error or invalid codes
     if (reply.code >= 400 || reply.code < 200)
     {
@@ -153,8 +198,9 @@ void FetchTaskImpl::fetchDone()
         reply.expires = -2;
 
     // availability tests
+    //   revalidated content keeps the original result
     if (state == Resource::State::downloading
-        && !performAvailTest())
+        && (revalidated ? revalidated->availFailed : !performAvailTest()))
     {
         LOG(info1) << "Resource <" << name
             << "> failed availability test";
@@ -186,11 +232,11 @@ void FetchTaskImpl::fetchDone()
     // write to cache
     if ((state == Resource::State::availFail
         || state == Resource::State::downloading)
-        && map->resources.queCacheWrite.estimateSize()
+        && map->resources.context->queCacheWrite.estimateSize()
         < map->options.maxCacheWriteQueueLength)
     {
-        // this makes copy of the content buffer
-        map->resources.queCacheWrite.push(CacheData(this,
+        // the content buffer is shared with the decoder
+        map->resources.context->queCacheWrite.push(CacheData(this,
             state == Resource::State::availFail));
     }
 
@@ -213,9 +259,11 @@ void FetchTaskImpl::fetchDone()
             if (state == Resource::State::downloaded)
             {
                 // this allows another thread to immediately start
-                //   processing the content, including its modification,
+                //   processing the content (which is shared and may be
+                //   read-only, see Buffer::data),
                 //   and must therefore be the last action in this thread
-                map->resources.queDecode.push(rs);
+                map->resources.context->queDecode.push(
+                    DecodeJob(rs), rs->priority, rs.get());
             }
         }
     }
@@ -233,13 +281,16 @@ void MapImpl::resourceDecodeProcess(const std::shared_ptr<Resource> &r)
     assert(r->state == Resource::State::downloaded);
     statistics.resourcesDecoded++;
     r->info.gpuMemoryCost = r->info.ramMemoryCost = 0;
+    // the decoder may take the content
+    const uint32 size = r->fetch ? r->fetch->reply.content.size() : 0;
     try
     {
         r->decode();
         if (r->requiresUpload())
         {
             r->state = Resource::State::decoded;
-            resources.queUpload.push(UploadData(r));
+            resources.queUpload.push(UploadData(r, size),
+                r->priority, r.get());
         }
         else
             r->state = Resource::State::ready;
@@ -255,18 +306,24 @@ void MapImpl::resourceDecodeProcess(const std::shared_ptr<Resource> &r)
     r->fetch.reset();
 }
 
-void MapImpl::resourcesDecodeProcessorEntry()
+void MapSharedContextImpl::decodeEntry()
 {
     OPTICK_THREAD("decode");
     setLogThreadName("decode");
-    while (!resources.queDecode.stopped())
+    while (!queDecode.stopped())
     {
-        std::weak_ptr<Resource> w;
-        resources.queDecode.waitPop(w);
-        std::shared_ptr<Resource> r = w.lock();
-        if (!r)
+        DecodeJob job;
+        if (!queDecode.waitPop(job))
+            continue;
+        MapImpl *map = acquire(job.mapId);
+        if (!map)
             continue;
-        resourceDecodeProcess(r);
+        {
+            std::shared_ptr<Resource> r = job.resource.lock();
+            if (r)
+                map->resourceDecodeProcess(r);
+        }
+        release(job.mapId);
     }
 }
 
@@ -308,17 +365,52 @@ void MapImpl::resourcesUploadProcessorEntry()
     }
 }
 
-void MapImpl::resourcesDataUpdate()
+void MapImpl::resourcesDataUpdate(double budgetMs)
 {
     OPTICK_EVENT();
-    for (uint32 proc = 0; proc
-        < options.maxResourceProcessesPerTick; proc++)
-    {
+    typedef std::chrono::steady_clock Clock;
+    const auto msSince = [](Clock::time_point t) {
+        return std::chrono::duration<double, std::milli>(
+            Clock::now() - t).count();
+    };
+    const bool timed = budgetMs > 0;
+    const uint64 bytesLimit
+        = (uint64)options.maxResourceUploadKBPerTick * 1024;
+    const Clock::time_point start = Clock::now();
+    uint64 bytes = 0;
+    for (uint32 proc = 0; timed
+        || proc < options.maxResourceProcessesPerTick; proc++)
+    {
+        // the next item is taken only if its expected cost fits
+        //   the remaining budget, at least one item is always processed
+        const auto fits = [&](const UploadData &w) {
+            if (proc == 0)
+                return true;
+            if (bytesLimit && bytes + w.size()
+                * resources.uploadGpuBytesPerByte >= bytesLimit)
+                return false;
+            if (timed && msSince(start) + w.size()
+                * resources.uploadMsPerByte > budgetMs)
+                return false;
+            return true;
+        };
         UploadData w;
-        if (resources.queUpload.tryPop(w))
-            w.process();
-        else
+        if (!resources.queUpload.tryPop(w, fits))
             break;
+        const Clock::time_point s = Clock::now();
+        const uint32 gpu = w.process();
+        bytes += gpu;
+        if (w.size() > 0)
+        {
+            // resources differ in size a lot,
+            //   therefore the costs are estimated per byte
+            const double ms = msSince(s);
+            auto &rs = resources;
+            rs.uploadMsPerByte = rs.uploadMsPerByte * 0.9
+                + ms / w.size() * 0.1;
+            rs.uploadGpuBytesPerByte = rs.uploadGpuBytesPerByte * 0.9
+                + (double)gpu / w.size() * 0.1;
+        }
     }
 }
 
@@ -332,14 +424,14 @@ void MapImpl::resourcesDataFinalize()
 // CACHE WRITE THREAD
 ////////////////////////////
 
-void MapImpl::cacheWriteEntry()
+void MapSharedContextImpl::cacheWriteEntry()
 {
     OPTICK_THREAD("cache writer");
     setLogThreadName("cache writer");
-    while (!resources.queCacheWrite.stopped())
+    while (!queCacheWrite.stopped())
     {
         CacheData cwd;
-        resources.queCacheWrite.waitPop(cwd);
+        queCacheWrite.waitPop(cwd);
         if (!cwd.name.empty())
             cacheWrite(std::move(cwd));
     }
@@ -355,26 +447,31 @@ void MapImpl::cacheReadEntry()
     setLogThreadName("cache reader");
     while (!resources.queCacheRead.stopped())
     {
-        auto res1 = resources.queCacheRead.readAllWait();
-        OPTICK_EVENT("update");
-        auto res2 = filterSortResources(res1, Resource::State::checkCache);
-        for (const auto &pr : res2)
+        std::shared_ptr<Resource> r = popResource(resources.queCacheRead,
+            Resource::State::checkCache);
+        if (!r)
+            continue;
+        // the queue may contain the resource multiple times
+        //   and other threads may already be processing it
+        if (r->cacheReading.exchange(true))
+            continue;
+        if (r->state != Resource::State::checkCache)
         {
-            const std::shared_ptr<Resource> &r = pr.second;
-            try
-            {
-                cacheReadProcess(r);
-            }
-            catch (const std::exception &e)
-            {
-                statistics.resourcesFailed++;
-                r->state = Resource::State::errorFatal;
-                LOG(err3) << "Failed preparing resource <" << r->name
-                    << ">, exception <" << e.what() << ">";
-            }
-            if (resources.queCacheRead.estimateSize() > 0)
-                break; // refresh the priorities
+            r->cacheReading = false;
+            continue;
+        }
+        try
+        {
+            cacheReadProcess(r);
+        }
+        catch (const std::exception &e)
+        {
+            statistics.resourcesFailed++;
+            r->state = Resource::State::errorFatal;
+            LOG(err3) << "Failed preparing resource <" << r->name
+                << ">, exception <" << e.what() << ">";
         }
+        r->cacheReading = false;
     }
 }
 
@@ -386,6 +483,28 @@ bool startsWith(const std::string &text, const std::string &start)
     return text.substr(0, start.length()) == start;
 }
 
+// format as in http headers, independent of locale
+std::string httpDate(sint64 time)
+{
+    static const char *days[] = {
+        "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+    static const char *months[] = {
+        "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+        "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+    std::time_t t = time;
+    std::tm tm;
+#ifdef _WIN32
+    gmtime_s(&tm, &t);
+#else
+    gmtime_r(&t, &tm);
+#endif
+    char buf[40];
+    snprintf(buf, sizeof(buf), "%s, %02d %s %04d %02d:%02d:%02d GMT",
+        days[tm.tm_wday], tm.tm_mday, months[tm.tm_mon], tm.tm_year + 1900,
+        tm.tm_hour, tm.tm_min, tm.tm_sec);
+    return buf;
+}
+
 } // namespace
 
 void MapImpl::cacheReadProcess(const std::shared_ptr<Resource> &r)
@@ -395,9 +514,24 @@ void MapImpl::cacheReadProcess(const std::shared_ptr<Resource> &r)
     if (!r->fetch)
         r->fetch = std::make_shared<FetchTaskImpl>(r);
     r->info.gpuMemoryCost = r->info.ramMemoryCost = 0;
+    r->fetch->stale.reset();
+    r->fetch->query.headers.erase("If-None-Match");
+    r->fetch->query.headers.erase("If-Modified-Since");
     CacheData cd;
-    if (r->allowDiskCache() && (cd = cacheRead(
-        r->name)).name == r->name)
+    if ((cd = cacheRead(r->name)).name == r->name
+        && (!r->allowDiskCache() || Cache::expired(cd.expires)))
+    {
+        // download with conditional request
+        //   the cached content is used if the server replies 304
+        if (!cd.etag.empty())
+            r->fetch->query.headers["If-None-Match"] = cd.etag;
+        if (cd.lastModified >= 0)
+            r->fetch->query.headers["If-Modified-Since"]
+                = httpDate(cd.lastModified);
+        r->fetch->stale = std::make_shared<CacheData>(std::move(cd));
+        cd = CacheData();
+    }
+    if (cd.name == r->name)
     {
         r->fetch->reply.expires = cd.expires;
         r->fetch->reply.content = std::move(cd.buffer);
@@ -439,7 +573,8 @@ void MapImpl::cacheReadProcess(const std::shared_ptr<Resource> &r)
     }
 
     if (r->state == Resource::State::downloaded)
-        resources.queDecode.push(r);
+        resources.context->queDecode.push(
+            DecodeJob(r), r->priority, r.get());
 }
 
 ////////////////////////////
@@ -451,46 +586,109 @@ void MapImpl::resourcesDownloadsEntry()
     OPTICK_THREAD("fetcher");
     setLogThreadName("fetcher");
     resources.fetcher->initialize();
-    std::mutex dummyMutex;
+    std::vector<std::weak_ptr<FetchTaskImpl>> active;
+    const auto slotFree = [this]() {
+        return resources.downloads
+            < resources.downloadsLimiter.limit(options);
+    };
     while (!resources.queFetching.stopped())
     {
-        auto res1 = resources.queFetching.readAllWait();
-        OPTICK_EVENT("update");
+        // the queue is the backlog, it is reordered by the main thread
+        //   while we wait, and an item is taken only once a slot is free
+        //   so that the resource with highest priority at that time starts
+        std::weak_ptr<Resource> w;
+        if (!resources.queFetching.waitPop(w, slotFree))
+            continue;
+        std::shared_ptr<Resource> r = acceptResource(w,
+            Resource::State::startDownload);
         resources.fetcher->update();
-        auto res2 = filterSortResources(res1, Resource::State::startDownload);
-        for (const auto &pr : res2)
+        if (!r)
+            continue;
+        OPTICK_EVENT("fetch");
+        // the main thread may cancel the download and replace the task
+        //   as soon as it sees the downloading state,
+        //   therefore the task is prepared first and the state is set last
+        std::shared_ptr<FetchTaskImpl> f = r->fetch;
+        f->finished = false;
+        LOG(debug) << "Initializing fetch of <" << r->name << ">";
+        f->query.headers["X-Vts-Client-Id"] = createOptions.clientId;
+        if (resources.auth)
+            resources.auth->authorize(r->name, f->query);
+        f->started = std::chrono::steady_clock::now();
+        resources.downloads++;
+        r->state = Resource::State::downloading;
+        // a task cancelled in the meantime is not started at all
+        //   (fetchDone ignores finished tasks anyway)
+        if (!f->finished)
+            resources.fetcher->fetch(f);
+        statistics.resourcesDownloaded++;
+        if (active.size() > 2 * options.maxConcurrentDownloads)
         {
-            while (resources.downloads >= options.maxConcurrentDownloads)
-            {
-                std::unique_lock<std::mutex> lock(dummyMutex);
-                resources.downloadsCondition.wait(lock);
-            }
-            const std::shared_ptr<Resource> &r = pr.second;
-            r->state = Resource::State::downloading;
-            resources.downloads++;
-            LOG(debug) << "Initializing fetch of <" << r->name << ">";
-            r->fetch->query.headers["X-Vts-Client-Id"]
-                = createOptions.clientId;
-            if (resources.auth)
-                resources.auth->authorize(r);
-            resources.fetcher->fetch(r->fetch);
-            statistics.resourcesDownloaded++;
-            if (resources.queFetching.estimateSize() > 0)
-                break; // refresh the priorities
+            active.erase(std::remove_if(active.begin(), active.end(),
+                [](const std::weak_ptr<FetchTaskImpl> &w) {
+                    auto f = w.lock();
+                    return !f || f->finished;
+                }), active.end());
         }
+        active.push_back(f);
+    }
+    // the fetcher may be shared with other maps and outlive this one
+    for (const auto &w : active)
+    {
+        auto f = w.lock();
+        if (f)
+            resourcesCancelFetch(f);
     }
     resources.fetcher->finalize();
     resources.fetcher.reset();
 }
 
+void MapImpl::resourcesReleaseDownloadSlot()
+{
+    resources.downloads--;
+    // the queue mutex orders the wake up after the predicate evaluation
+    //   in the fetcher thread, therefore it cannot be missed
+    resources.queFetching.notify();
+}
+
 ////////////////////////////
 // MAIN THREAD
 ////////////////////////////
 
+bool MapImpl::resourcesCancelFetch(
+    const std::shared_ptr<FetchTaskImpl> &fetch)
+{
+    if (fetch->finished.exchange(true))
+        return false; // already done
+    LOG(info1) << "Cancelling download of <" << fetch->name << ">";
+    resourcesReleaseDownloadSlot();
+    resources.fetcher->cancel(fetch);
+    statistics.resourcesCancelled++;
+    return true;
+}
+
+void MapImpl::resourceCancelDownload(const std::shared_ptr<Resource> &r)
+{
+    std::shared_ptr<FetchTaskImpl> old = r->fetch;
+    if (!resourcesCancelFetch(old))
+        return;
+    // the old task may still be in use by the fetcher
+    r->fetch = std::make_shared<FetchTaskImpl>(r);
+    r->fetch->availTest = old->availTest;
+    r->state = Resource::State::initializing;
+}
+
 bool MapImpl::resourcesTryRemove(std::shared_ptr<Resource> &r)
 {
     std::string name = r->name;
     assert(resources.resources.count(name) == 1);
+    std::shared_ptr<FetchTaskImpl> fetch;
+    if (r->state == Resource::State::downloading)
+        fetch = r->fetch;
+    // the neighbour stays alive, so the position can be restored
+    Resource *lruPrev = r->lruPrev;
+    resources.states.untrack(r.get());
+    resources.lru.remove(r.get());
     {
         // release the pointer if we are the last one holding it
         std::weak_ptr<Resource> w = r;
@@ -514,82 +712,102 @@ bool MapImpl::resourcesTryRemove(std::shared_ptr<Resource> &r)
         LOG(info1) << "Released resource <" << name << ">";
         resources.resources.erase(name);
         statistics.resourcesReleased++;
+        if (fetch)
+            resourcesCancelFetch(fetch);
         return true;
     }
+    resources.states.track(r.get());
+    resources.lru.insertAfter(r.get(), lruPrev);
     return false;
 }
 
 void MapImpl::resourcesRemoveOld()
 {
     OPTICK_EVENT();
-    struct Res
-    {
-        const std::string *n; // name
-        uint32 m; // memory used
-        uint32 a; // lastAccessTick
-        Res(const std::string *n, uint32 m, uint32 a) : n(n), m(m), a(a)
-        {}
-    };
-    // successfully loaded resources are removed
-    //   only when we are tight on memory
-    std::vector<Res> resourcesToRemove;
-    resourcesToRemove.reserve(resources.resources.size() / 4);
+    const ResourceStates &s = resources.states;
+    statistics.currentGpuMemUseKB = s.gpuMemoryUse() / 1024;
+    statistics.currentRamMemUseKB = s.ramMemoryUse() / 1024;
+    statistics.currentTexturesMemUseKB
+        = s.memoryUse(Resource::MemoryType::textures) / 1024;
+    statistics.currentMeshesMemUseKB
+        = s.memoryUse(Resource::MemoryType::meshes) / 1024;
+    statistics.currentMetatilesMemUseKB
+        = s.memoryUse(Resource::MemoryType::metatiles) / 1024;
+    statistics.currentGeodataMemUseKB
+        = s.memoryUse(Resource::MemoryType::geodata) / 1024;
+    statistics.currentFontsMemUseKB
+        = s.memoryUse(Resource::MemoryType::fonts) / 1024;
+
     // resources that errored are removed immediately
-    std::vector<Res> unconditionalToRemove;
-    unconditionalToRemove.reserve(resources.resources.size() / 4);
-    uint64 memRamUse = 0;
-    uint64 memGpuUse = 0;
-    // find resource candidates for removal
-    for (const auto &it : resources.resources)
-    {
-        memRamUse += it.second->info.ramMemoryCost;
-        memGpuUse += it.second->info.gpuMemoryCost;
-        // skip recently used resources
-        if (it.second->lastAccessTick + 5 < renderTickIndex)
+    {
+        std::vector<Resource *> list;
+        resources.states.collect(Resource::State::initializing, list);
+        resources.states.collect(Resource::State::startDownload, list);
+        resources.states.collect(Resource::State::errorFatal, list);
+        resources.states.collect(Resource::State::errorRetry, list);
+        resources.states.collect(Resource::State::availFail, list);
+        for (Resource *r : list)
         {
-            Res r(&it.second->name,
-                it.second->info.ramMemoryCost + it.second->info.gpuMemoryCost,
-                it.second->lastAccessTick);
-            switch ((vts::Resource::State)it.second->state)
-            {
-            case Resource::State::initializing:
-            case Resource::State::startDownload:
-            case Resource::State::errorFatal:
-            case Resource::State::errorRetry:
-            case Resource::State::availFail:
-                unconditionalToRemove.push_back(std::move(r));
-                break;
-            default:
-                resourcesToRemove.push_back(std::move(r));
-                break;
-            }
+            // skip recently used resources
+            if (r->lastAccessTick + 5 < renderTickIndex)
+                resourcesTryRemove(resources.resources[r->name]);
         }
     }
-    statistics.currentGpuMemUseKB = memGpuUse / 1024;
-    statistics.currentRamMemUseKB = memRamUse / 1024;
-    uint64 memUse = memRamUse + memGpuUse;
-    // remove unconditionalToRemove
-    for (const Res &res : unconditionalToRemove)
-    {
-        if (resourcesTryRemove(resources.resources[*res.n]))
-            memUse -= res.m;
-    }
-    // remove resourcesToRemove
+
+    // successfully loaded resources are removed
+    //   only when we are tight on memory
     uint64 trs = (uint64)options.targetResourcesMemoryKB * 1024;
-    if (memUse > trs)
-    {
-        std::sort(resourcesToRemove.begin(), resourcesToRemove.end(),
-                  [](const Res &a, const Res &b){
-            return a.a < b.a; // least recently used first
-        });
-        for (const Res &res : resourcesToRemove)
+    uint64 trsRam = (uint64)options.targetResourcesRamKB * 1024;
+    uint64 trsGpu = (uint64)options.targetResourcesGpuKB * 1024;
+    const uint64 quotas[Resource::MemoryTypesCount] = {
+        (uint64)options.targetTexturesMemoryKB * 1024,
+        (uint64)options.targetMeshesMemoryKB * 1024,
+        (uint64)options.targetMetatilesMemoryKB * 1024,
+        (uint64)options.targetGeodataMemoryKB * 1024,
+        (uint64)options.targetFontsMemoryKB * 1024,
+        0, // other
+    };
+    const auto overQuota = [&](uint32 t) {
+        return quotas[t] && s.memoryUse((Resource::MemoryType)t) > quotas[t];
+    };
+    Resource *r = resources.lru.oldest();
+    while (r)
+    {
+        bool total = s.ramMemoryUse() + s.gpuMemoryUse() > trs;
+        bool ram = trsRam && s.ramMemoryUse() > trsRam;
+        bool gpu = trsGpu && s.gpuMemoryUse() > trsGpu;
+        bool quota = false;
+        for (uint32 t = 0; t < Resource::MemoryTypesCount; t++)
+            quota = quota || overQuota(t);
+        if (!total && !ram && !gpu && !quota)
+            break;
+        // the rest of the list was used recently
+        //   and only the gpu limit is enforced for it
+        bool recent = r->lastAccessTick + 5 >= renderTickIndex;
+        if (recent && !gpu)
+            break;
+        Resource *next = r->lruNext;
+        // this runs before the traversal, therefore resources used
+        //   in the last frame have the previous tick index
+        bool release = recent
+            ? r->stateGpuCost > 0 && r->lastAccessTick + 1 < renderTickIndex
+            : total || (ram && r->stateRamCost > 0)
+                || (gpu && r->stateGpuCost > 0)
+                || overQuota((uint32)r->stateMemoryType);
+        if (release)
+            resourcesTryRemove(resources.resources[r->name]);
+        r = next;
+    }
+    // forget keys of released resources
+    auto &keys = resources.resourcesByKey;
+    if (keys.size() > resources.resources.size() * 2 + 1000)
+    {
+        for (auto it = keys.begin(); it != keys.end();)
         {
-            if (resourcesTryRemove(resources.resources[*res.n]))
-            {
-                memUse -= res.m;
-                if (memUse < trs)
-                    break;
-            }
+            if (it->second.expired())
+                it = keys.erase(it);
+            else
+                it++;
         }
     }
 }
@@ -598,10 +816,22 @@ void MapImpl::resourcesCheckInitialized()
 {
     OPTICK_EVENT();
     std::time_t current = std::time(nullptr);
+    std::vector<Resource *> list;
+
+    // free the download slot for resources that are wanted
+    resources.states.collect(Resource::State::downloading, list);
+    for (Resource *r : list)
+    {
+        if (r->lastAccessTick + 5 < renderTickIndex
+            && r->priority < inf1())
+            resourceCancelDownload(r->shared_from_this());
+    }
 
-    for (const auto &it : resources.resources)
+    list.clear();
+    resources.states.collect(Resource::State::errorRetry, list);
+    resources.states.collect(Resource::State::initializing, list);
+    for (Resource *r : list)
     {
-        const std::shared_ptr<Resource> &r = it.second;
         if (r->lastAccessTick + 3 < renderTickIndex)
             continue; // skip resources that were not accessed last tick
         switch ((Resource::State)r->state)
@@ -645,24 +875,20 @@ void MapImpl::resourcesCheckInitialized()
 void MapImpl::resourcesStartDownloads()
 {
     OPTICK_EVENT();
-    std::vector<std::weak_ptr<Resource>> requestCacheRead;
-    std::vector<std::weak_ptr<Resource>> requestDownloads;
+    std::vector<std::pair<float, std::weak_ptr<Resource>>> requestCacheRead;
+    std::vector<std::pair<float, std::weak_ptr<Resource>>> requestDownloads;
+    std::vector<Resource *> list;
 
-    for (const auto &it : resources.resources)
-    {
-        const std::shared_ptr<Resource> &r = it.second;
-        switch ((Resource::State)r->state)
-        {
-        case Resource::State::checkCache:
-            requestCacheRead.push_back(r);
-            break;
-        case Resource::State::startDownload:
-            requestDownloads.push_back(r);
-            break;
-        default:
-            break;
-        }
-    }
+    resources.states.collect(Resource::State::checkCache, list);
+    requestCacheRead.reserve(list.size());
+    for (Resource *r : list)
+        requestCacheRead.emplace_back(r->priority, r->shared_from_this());
+
+    list.clear();
+    resources.states.collect(Resource::State::startDownload, list);
+    requestDownloads.reserve(list.size());
+    for (Resource *r : list)
+        requestDownloads.emplace_back(r->priority, r->shared_from_this());
 
     statistics.resourcesQueueCacheRead = requestCacheRead.size();
     resources.queCacheRead.writeAll(requestCacheRead);
@@ -672,8 +898,6 @@ void MapImpl::resourcesStartDownloads()
 
 void MapImpl::resourcesTerminateAllQueues()
 {
-    resources.queCacheWrite.terminate();
-    resources.queDecode.terminate();
     resources.queUpload.terminate();
     resources.queAtmosphere.terminate();
     resources.queGeodata.terminate();
@@ -689,6 +913,9 @@ void MapImpl::resourcesRenderFinalize()
     purgeMapconfig();
 
     // clear the resources now while all the necessary things are still working
+    resources.states.untrackAll();
+    resources.lru.clear();
+    resources.resourcesByKey.clear();
     resources.resources.clear();
 
     // allow the dataAllRun method to return to the caller
@@ -704,41 +931,34 @@ void MapImpl::resourcesRenderUpdate()
 
         // resourcesPreparing is used to determine mapRenderComplete
         //   and must be updated every frame
-        statistics.resourcesPreparing = 0;
-        for (const auto &it : resources.resources)
-        {
-            switch ((Resource::State)it.second->state)
-            {
-            case Resource::State::initializing:
-            case Resource::State::checkCache:
-            case Resource::State::startDownload:
-            case Resource::State::downloading:
-            case Resource::State::downloaded:
-            case Resource::State::decoded:
-                statistics.resourcesPreparing++;
-                break;
-            case Resource::State::ready:
-            case Resource::State::errorFatal:
-            case Resource::State::errorRetry:
-            case Resource::State::availFail:
-                break;
-            }
-        }
+        const ResourceStates &s = resources.states;
+        statistics.resourcesPreparing
+            = s.count(Resource::State::initializing)
+            + s.count(Resource::State::checkCache)
+            + s.count(Resource::State::startDownload)
+            + s.count(Resource::State::downloading)
+            + s.count(Resource::State::downloaded)
+            + s.count(Resource::State::decoded);
 
         statistics.resourcesActive
             = resources.resources.size();
         statistics.resourcesDownloading
             = resources.downloads;
         statistics.resourcesQueueCacheWrite
-            = resources.queCacheWrite.estimateSize();
+            = resources.context->queCacheWrite.estimateSize();
         statistics.resourcesQueueDecode
-            = resources.queDecode.estimateSize();
+            = resources.context->queDecode.estimateSize();
         statistics.resourcesQueueUpload
             = resources.queUpload.estimateSize();
         statistics.resourcesQueueGeodata
             = resources.queGeodata.estimateSize();
         statistics.resourcesQueueAtmosphere
             = resources.queAtmosphere.estimateSize();
+        statistics.currentDownloadsLimit
+            = resources.downloadsLimiter.limit(options);
+        resources.downloadsLimiter.statistics(
+            statistics.currentDownloadLatencyMs,
+            statistics.currentDownloadThroughputKBps);
     }
 
     // split workload into multiple render frames
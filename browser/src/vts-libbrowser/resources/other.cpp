@@ -42,15 +42,17 @@ BoundMetaTile::BoundMetaTile(MapImpl *map, const std::string &name) :
 void BoundMetaTile::decode()
 {
     Buffer buffer = std::move(fetch->reply.content);
-    GpuTextureSpec spec;
-    decodeImage(buffer, spec.buffer,
-                spec.width, spec.height, spec.components);
-    if (spec.buffer.size() != sizeof(flags))
+    uint32 width = 0, height = 0, components = 0;
+    decodeImage(buffer, image, width, height, components);
+    if (width != vtslibs::registry::BoundLayer::rasterMetatileWidth
+        || height != vtslibs::registry::BoundLayer::rasterMetatileHeight
+        || components != 1)
         LOGTHROW(err1, std::runtime_error)
                 << "bound meta tile has invalid resolution";
-    memcpy(flags, spec.buffer.data(), spec.buffer.size());
+    // the flags are used directly from the decoded image, without a copy
+    flags = (const uint8 *)image.data();
     info.ramMemoryCost += sizeof(*this);
-    info.ramMemoryCost += spec.buffer.size();
+    info.ramMemoryCost += image.size();
 }
 
 FetchTask::ResourceType BoundMetaTile::resourceType() const
@@ -27,18 +27,26 @@
 #include "../resource.hpp"
 #include "../fetchTask.hpp"
 #include "../map.hpp"
+#include "../sharedContext.hpp"
 
 namespace vts
 {
 
 FetchTaskImpl::FetchTaskImpl(const std::shared_ptr<Resource> &resource) :
 	FetchTask(resource->name, resource->resourceType()),
-    name(resource->name), map(resource->map), resource(resource)
+    name(resource->name), map(resource->map), mapId(resource->map->id),
+    context(resource->map->resources.context), resource(resource)
 {
     reply.expires = -1;
 }
 
 bool FetchTaskImpl::performAvailTest() const
+{
+    return vts::performAvailTest(availTest, reply);
+}
+
+bool performAvailTest(const std::shared_ptr<void> &availTest,
+    const FetchTask::Reply &reply)
 {
     if (!availTest)
         return true;
@@ -62,6 +70,189 @@ bool FetchTaskImpl::performAvailTest() const
     return true;
 }
 
+Resource::StateHolder &Resource::StateHolder::operator = (State s)
+{
+    owner->map->resources.states.assign(owner, s);
+    return *this;
+}
+
+ResourceStates::ResourceStates()
+{
+    heads.fill(nullptr);
+    for (auto &c : counts)
+        c = 0;
+    for (auto &c : typeUse)
+        c = 0;
+}
+
+void ResourceStates::link(Resource *r, State s)
+{
+    Resource *&h = heads[(uint32)s];
+    r->statePrev = nullptr;
+    r->stateNext = h;
+    if (h)
+        h->statePrev = r;
+    h = r;
+    counts[(uint32)s]++;
+}
+
+void ResourceStates::unlink(Resource *r, State s)
+{
+    if (r->statePrev)
+        r->statePrev->stateNext = r->stateNext;
+    else
+    {
+        assert(heads[(uint32)s] == r);
+        heads[(uint32)s] = r->stateNext;
+    }
+    if (r->stateNext)
+        r->stateNext->statePrev = r->statePrev;
+    r->statePrev = r->stateNext = nullptr;
+    counts[(uint32)s]--;
+}
+
+void ResourceStates::account(Resource *r)
+{
+    ramUse += r->info.ramMemoryCost;
+    ramUse -= r->stateRamCost;
+    gpuUse += r->info.gpuMemoryCost;
+    gpuUse -= r->stateGpuCost;
+    std::atomic<uint64> &t = typeUse[(uint32)r->stateMemoryType];
+    t += r->info.ramMemoryCost + r->info.gpuMemoryCost;
+    t -= r->stateRamCost + r->stateGpuCost;
+    r->stateRamCost = r->info.ramMemoryCost;
+    r->stateGpuCost = r->info.gpuMemoryCost;
+}
+
+void ResourceStates::unaccount(Resource *r)
+{
+    ramUse -= r->stateRamCost;
+    gpuUse -= r->stateGpuCost;
+    typeUse[(uint32)r->stateMemoryType]
+        -= r->stateRamCost + r->stateGpuCost;
+    r->stateRamCost = r->stateGpuCost = 0;
+}
+
+void ResourceStates::track(Resource *r)
+{
+    std::lock_guard<std::mutex> lock(mut);
+    if (r->stateTracked)
+        return;
+    r->stateTracked = true;
+    r->stateMemoryType = r->memoryType();
+    link(r, r->state.state);
+    account(r);
+}
+
+void ResourceStates::untrack(Resource *r)
+{
+    std::lock_guard<std::mutex> lock(mut);
+    if (!r->stateTracked)
+        return;
+    r->stateTracked = false;
+    unlink(r, r->state.state);
+    unaccount(r);
+}
+
+void ResourceStates::untrackAll()
+{
+    std::lock_guard<std::mutex> lock(mut);
+    for (uint32 s = 0; s < Resource::StatesCount; s++)
+    {
+        while (heads[s])
+        {
+            Resource *r = heads[s];
+            r->stateTracked = false;
+            unlink(r, (State)s);
+            unaccount(r);
+        }
+    }
+}
+
+void ResourceStates::assign(Resource *r, State s)
+{
+    std::lock_guard<std::mutex> lock(mut);
+    State old = r->state.state.exchange(s);
+    if (!r->stateTracked)
+        return;
+    if (old != s)
+    {
+        unlink(r, old);
+        link(r, s);
+    }
+    account(r);
+}
+
+void ResourceStates::collect(State s, std::vector<Resource *> &out)
+{
+    std::lock_guard<std::mutex> lock(mut);
+    for (Resource *r = heads[(uint32)s]; r; r = r->stateNext)
+        out.push_back(r);
+}
+
+void ResourceLru::insert(Resource *r)
+{
+    assert(!r->lruLinked);
+    r->lruLinked = true;
+    r->lruPrev = tail;
+    r->lruNext = nullptr;
+    if (tail)
+        tail->lruNext = r;
+    else
+        head = r;
+    tail = r;
+    count++;
+}
+
+void ResourceLru::insertAfter(Resource *r, Resource *prev)
+{
+    assert(!r->lruLinked);
+    assert(!prev || prev->lruLinked);
+    r->lruLinked = true;
+    r->lruPrev = prev;
+    r->lruNext = prev ? prev->lruNext : head;
+    if (r->lruNext)
+        r->lruNext->lruPrev = r;
+    else
+        tail = r;
+    if (prev)
+        prev->lruNext = r;
+    else
+        head = r;
+    count++;
+}
+
+void ResourceLru::remove(Resource *r)
+{
+    if (!r->lruLinked)
+        return;
+    r->lruLinked = false;
+    if (r->lruPrev)
+        r->lruPrev->lruNext = r->lruNext;
+    else
+        head = r->lruNext;
+    if (r->lruNext)
+        r->lruNext->lruPrev = r->lruPrev;
+    else
+        tail = r->lruPrev;
+    r->lruPrev = r->lruNext = nullptr;
+    count--;
+}
+
+void ResourceLru::touch(Resource *r)
+{
+    if (!r->lruLinked || r == tail)
+        return;
+    remove(r);
+    insert(r);
+}
+
+void ResourceLru::clear()
+{
+    while (head)
+        remove(head);
+}
+
 Resource::Resource(vts::MapImpl *map, const std::string &name) :
     name(name), map(map),
     priority(nan1())
@@ -74,11 +265,34 @@ Resource::~Resource()
 {
     LOG(debug) << "Destroying resource <" << name
                << "> at <" << this << ">";
+    map->resources.states.untrack(this);
     if (info.userData)
     {
         //assert(!map->resources.queUpload.stopped());
         map->resources.queUpload.push(
-            UploadData(info.userData, 0));
+            UploadData(info.userData, 0), inf1());
+    }
+}
+
+Resource::MemoryType Resource::memoryType() const
+{
+    switch (resourceType())
+    {
+    case FetchTask::ResourceType::Texture:
+        return MemoryType::textures;
+    case FetchTask::ResourceType::Mesh:
+        return MemoryType::meshes;
+    case FetchTask::ResourceType::MetaTile:
+    case FetchTask::ResourceType::BoundMetaTile:
+    case FetchTask::ResourceType::NavTile:
+        return MemoryType::metatiles;
+    case FetchTask::ResourceType::GeodataFeatures:
+    case FetchTask::ResourceType::GeodataStylesheet:
+        return MemoryType::geodata;
+    case FetchTask::ResourceType::Font:
+        return MemoryType::fonts;
+    default:
+        return MemoryType::other;
     }
 }
 
@@ -102,12 +316,47 @@ bool Resource::allowDiskCache(FetchTask::ResourceType type)
     }
 }
 
+bool Resource::allowDiskCompression(FetchTask::ResourceType type)
+{
+    switch (type)
+    {
+    case FetchTask::ResourceType::Mapconfig:
+    case FetchTask::ResourceType::AuthConfig:
+    case FetchTask::ResourceType::BoundLayerConfig:
+    case FetchTask::ResourceType::FreeLayerConfig:
+    case FetchTask::ResourceType::TilesetMappingConfig:
+    case FetchTask::ResourceType::MetaTile:
+    case FetchTask::ResourceType::Mesh:
+    case FetchTask::ResourceType::Search:
+    case FetchTask::ResourceType::SriIndex:
+    case FetchTask::ResourceType::GeodataFeatures:
+    case FetchTask::ResourceType::GeodataStylesheet:
+        return true;
+    default:
+        return false; // images and fonts are compressed already
+    }
+}
+
 void Resource::updatePriority(float p)
 {
-    if (!std::isnan(priority))
-        priority = std::max(priority, p);
-    else
-        priority = p;
+    if (!std::isnan(priority) && !(p > priority))
+        return;
+    priority = p;
+
+    // reorder the resource if it is waiting in a queue
+    //   (cache reads and downloads are resorted regularly by the main thread)
+    switch ((State)state)
+    {
+    case State::downloaded:
+        if (!map->resources.context->queDecode.updatePriority(this, p))
+            map->resources.queGeodata.updatePriority(this, p);
+        break;
+    case State::decoded:
+        map->resources.queUpload.updatePriority(this, p);
+        break;
+    default:
+        break;
+    }
 }
 
 void Resource::updateAvailability(const std::shared_ptr<void> &availTest)
@@ -40,15 +40,21 @@ namespace vts
 namespace
 {
 
-template<class T>
-std::shared_ptr<T> getMapResource(MapImpl *map, const std::string &name)
+// the init is applied to newly created resources only,
+//   before any other thread may see them
+template<class T, class F>
+std::shared_ptr<T> getMapResource(MapImpl *map, const std::string &name,
+    F init)
 {
     assert(!name.empty());
     auto it = map->resources.resources.find(name);
     if (it == map->resources.resources.end())
     {
         auto r = std::make_shared<T>(map, name);
+        init(*r);
         it = map->resources.resources.insert(std::make_pair(name, r)).first;
+        map->resources.states.track(r.get());
+        map->resources.lru.insert(r.get());
         map->statistics.resourcesCreated++;
     }
     assert(it->second);
@@ -58,11 +64,69 @@ std::shared_ptr<T> getMapResource(MapImpl *map, const std::string &name)
     return res;
 }
 
+template<class T>
+std::shared_ptr<T> getMapResource(MapImpl *map, const std::string &name)
+{
+    return getMapResource<T>(map, name, [](T &) {});
+}
+
+template<class T, class F>
+std::shared_ptr<T> getMapResource(MapImpl *map,
+    const InternedUrlTemplate &url, const UrlTemplate::Vars &vars, F init)
+{
+    ResourceKey key(url, vars);
+    std::weak_ptr<Resource> &w = map->resources.resourcesByKey[key];
+    std::shared_ptr<Resource> r = w.lock();
+    // resources no longer owned by the map are looked up by the name
+    if (r && r->stateTracked)
+    {
+        map->touchResource(r);
+        auto res = std::dynamic_pointer_cast<T>(r);
+        assert(res);
+        return res;
+    }
+    auto res = getMapResource<T>(map, url(vars), init);
+    w = res;
+    return res;
+}
+
+template<class T>
+std::shared_ptr<T> getMapResource(MapImpl *map,
+    const InternedUrlTemplate &url, const UrlTemplate::Vars &vars)
+{
+    return getMapResource<T>(map, url, vars, [](T &) {});
+}
+
+std::atomic<uint32> lastUrlTemplateId {0};
+
 } // namespace
 
+void InternedUrlTemplate::parse(const std::string &str)
+{
+    UrlTemplate::parse(str);
+    id = ++lastUrlTemplateId;
+}
+
+ResourceKey::ResourceKey(const InternedUrlTemplate &url,
+    const UrlTemplate::Vars &vars) :
+    tileId(vars.tileId), localId(vars.localId),
+    templateId(url.id), subMesh(vars.subMesh)
+{}
+
+bool ResourceKey::operator == (const ResourceKey &other) const
+{
+    return templateId == other.templateId
+        && subMesh == other.subMesh
+        && tileId == other.tileId
+        && localId == other.localId;
+}
+
 void MapImpl::touchResource(const std::shared_ptr<Resource> &resource)
 {
+    if (resource->lastAccessTick == renderTickIndex)
+        return;
     resource->lastAccessTick = renderTickIndex;
+    resources.lru.touch(resource.get());
 }
 
 Validity MapImpl::getResourceValidity(const std::string &name)
@@ -93,6 +157,14 @@ std::shared_ptr<GpuTexture> MapImpl::getTexture(const std::string &name)
     return getMapResource<GpuTexture>(this, name);
 }
 
+std::shared_ptr<GpuTexture> MapImpl::getTexture(
+    const InternedUrlTemplate &url, const UrlTemplate::Vars &vars,
+    TextureCompression compression)
+{
+    return getMapResource<GpuTexture>(this, url, vars,
+        [=](GpuTexture &t) { t.compression = compression; });
+}
+
 std::shared_ptr<GpuAtmosphereDensityTexture>
 MapImpl::getAtmosphereDensityTexture(
     const std::string &name)
@@ -120,12 +192,24 @@ std::shared_ptr<MetaTile> MapImpl::getMetaTile(const std::string &name)
     return getMapResource<MetaTile>(this, name);
 }
 
+std::shared_ptr<MetaTile> MapImpl::getMetaTile(
+    const InternedUrlTemplate &url, const UrlTemplate::Vars &vars)
+{
+    return getMapResource<MetaTile>(this, url, vars);
+}
+
 std::shared_ptr<MeshAggregate> MapImpl::getMeshAggregate(
         const std::string &name)
 {
     return getMapResource<MeshAggregate>(this, name);
 }
 
+std::shared_ptr<MeshAggregate> MapImpl::getMeshAggregate(
+    const InternedUrlTemplate &url, const UrlTemplate::Vars &vars)
+{
+    return getMapResource<MeshAggregate>(this, url, vars);
+}
+
 std::shared_ptr<ExternalBoundLayer> MapImpl::getExternalBoundLayer(
         const std::string &name)
 {
@@ -144,6 +228,12 @@ std::shared_ptr<BoundMetaTile> MapImpl::getBoundMetaTile(
     return getMapResource<BoundMetaTile>(this, name);
 }
 
+std::shared_ptr<BoundMetaTile> MapImpl::getBoundMetaTile(
+    const InternedUrlTemplate &url, const UrlTemplate::Vars &vars)
+{
+    return getMapResource<BoundMetaTile>(this, url, vars);
+}
+
 std::shared_ptr<SearchTaskImpl> MapImpl::getSearchTask(const std::string &name)
 {
     return getMapResource<SearchTaskImpl>(this, name);
@@ -0,0 +1,253 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "../include/vts-browser/log.hpp"
+#include "../include/vts-browser/fetcher.hpp"
+
+#include "../sharedContext.hpp"
+#include "../resource.hpp"
+
+#include <algorithm>
+
+namespace vts
+{
+
+namespace
+{
+
+class MergingFetcher;
+
+// single download shared by all tasks with same url and headers
+class MergedTask : public FetchTask
+{
+public:
+    MergedTask(MergingFetcher *fetcher, const std::string &key,
+        const std::shared_ptr<FetchTask> &task);
+    void fetchDone() override;
+
+    MergingFetcher *const fetcher;
+    const std::string key;
+    std::vector<std::shared_ptr<FetchTask>> waiting;
+};
+
+class MergingFetcher : public Fetcher
+{
+public:
+    explicit MergingFetcher(const std::shared_ptr<Fetcher> &fetcher) :
+        fetcher(fetcher)
+    {}
+
+    void initialize() override
+    {
+        fetcher->initialize();
+    }
+
+    void finalize() override
+    {
+        fetcher->finalize();
+    }
+
+    void update() override
+    {
+        fetcher->update();
+    }
+
+    void fetch(const std::shared_ptr<FetchTask> &task) override
+    {
+        std::string key = makeKey(task->query);
+        std::shared_ptr<MergedTask> m;
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            auto it = tasks.find(key);
+            if (it != tasks.end())
+            {
+                LOG(debug) << "Download of <" << task->query.url
+                    << "> merged with another one in progress";
+                it->second->waiting.push_back(task);
+                return;
+            }
+            m = std::make_shared<MergedTask>(this, key, task);
+            m->waiting.push_back(task);
+            tasks[key] = m;
+        }
+        fetcher->fetch(m);
+    }
+
+    void cancel(const std::shared_ptr<FetchTask> &task) override
+    {
+        std::shared_ptr<MergedTask> m;
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            auto it = tasks.find(makeKey(task->query));
+            if (it == tasks.end())
+                return;
+            auto &w = it->second->waiting;
+            auto t = std::find(w.begin(), w.end(), task);
+            if (t == w.end())
+                return;
+            w.erase(t);
+            if (w.empty())
+            {
+                // nobody else is interested in the download
+                m = it->second;
+                tasks.erase(it);
+            }
+        }
+        task->reply.code = FetchTask::ExtraCodes::Cancelled;
+        task->fetchDone();
+        if (m)
+            fetcher->cancel(m);
+    }
+
+    static std::string makeKey(const FetchTask::Query &query)
+    {
+        std::string key = query.url;
+        for (const auto &it : query.headers)
+            key += "\n" + it.first + ": " + it.second;
+        return key;
+    }
+
+    const std::shared_ptr<Fetcher> fetcher;
+    std::unordered_map<std::string, std::shared_ptr<MergedTask>> tasks;
+    std::mutex mut;
+};
+
+MergedTask::MergedTask(MergingFetcher *fetcher, const std::string &key,
+    const std::shared_ptr<FetchTask> &task) :
+    FetchTask(task->query), fetcher(fetcher), key(key)
+{}
+
+void MergedTask::fetchDone()
+{
+    std::vector<std::shared_ptr<FetchTask>> tasks;
+    {
+        std::lock_guard<std::mutex> lock(fetcher->mut);
+        auto it = fetcher->tasks.find(key);
+        if (it != fetcher->tasks.end() && it->second.get() == this)
+            fetcher->tasks.erase(it);
+        tasks.swap(waiting);
+    }
+    for (std::size_t i = 0, e = tasks.size(); i < e; i++)
+    {
+        FetchTask &t = *tasks[i];
+        t.reply.contentType = reply.contentType;
+        t.reply.redirectUrl = reply.redirectUrl;
+        t.reply.expires = reply.expires;
+        t.reply.etag = reply.etag;
+        t.reply.lastModified = reply.lastModified;
+        t.reply.code = reply.code;
+        if (i + 1 < e)
+            t.reply.content = reply.content.share();
+        else
+            t.reply.content = std::move(reply.content);
+        t.fetchDone();
+    }
+}
+
+} // namespace
+
+DecodeJob::DecodeJob(const std::shared_ptr<Resource> &resource) :
+    resource(resource), mapId(resource->map->id)
+{}
+
+MapSharedContext::~MapSharedContext()
+{}
+
+std::shared_ptr<MapSharedContext> MapSharedContext::create(
+    const MapCreateOptions &options,
+    const std::shared_ptr<Fetcher> &fetcher)
+{
+    return std::make_shared<MapSharedContextImpl>(options, fetcher);
+}
+
+MapSharedContextImpl::MapSharedContextImpl(const MapCreateOptions &options,
+    const std::shared_ptr<Fetcher> &fetcher) :
+    createOptions(options),
+    fetcher(std::make_shared<MergingFetcher>(fetcher))
+{
+    assert(fetcher);
+    cacheInit();
+    thrCacheWriter
+        = std::thread(&MapSharedContextImpl::cacheWriteEntry, this);
+    uint32 cnt = options.decodeThreads;
+    if (cnt == 0)
+    {
+        uint32 hw = std::thread::hardware_concurrency();
+        cnt = hw > 3 ? hw - 2 : 1;
+    }
+    thrDecoders.reserve(cnt);
+    for (uint32 i = 0; i < cnt; i++)
+        thrDecoders.push_back(std::thread(
+            &MapSharedContextImpl::decodeEntry, this));
+}
+
+MapSharedContextImpl::~MapSharedContextImpl()
+{
+    assert(maps.empty());
+    queDecode.terminate();
+    queCacheWrite.terminate();
+    for (std::thread &t : thrDecoders)
+        t.join();
+    thrCacheWriter.join();
+}
+
+void MapSharedContextImpl::attach(MapImpl *map)
+{
+    std::lock_guard<std::mutex> lock(mapsMutex);
+    assert(maps.count(map->id) == 0);
+    maps[map->id].map = map;
+}
+
+void MapSharedContextImpl::detach(MapImpl *map)
+{
+    std::unique_lock<std::mutex> lock(mapsMutex);
+    MapUsers &u = maps[map->id];
+    u.detaching = true; // no new work is accepted
+    while (u.active > 0)
+        mapsCondition.wait(lock);
+    maps.erase(map->id);
+}
+
+MapImpl *MapSharedContextImpl::acquire(uint64 mapId)
+{
+    std::lock_guard<std::mutex> lock(mapsMutex);
+    auto it = maps.find(mapId);
+    if (it == maps.end() || it->second.detaching)
+        return nullptr; // the map is being destroyed
+    it->second.active++;
+    return it->second.map;
+}
+
+void MapSharedContextImpl::release(uint64 mapId)
+{
+    {
+        std::lock_guard<std::mutex> lock(mapsMutex);
+        maps[mapId].active--;
+    }
+    mapsCondition.notify_all();
+}
+
+} // namespace vts
@@ -34,9 +34,10 @@
 namespace vts
 {
 
-GpuTextureSpec::GpuTextureSpec(const Buffer &buffer)
+GpuTextureSpec::GpuTextureSpec(const Buffer &buffer, bool verticalFlip)
 {
-    decodeImage(buffer, this->buffer, width, height, components);
+    decodeImage(buffer, this->buffer, width, height, components,
+        verticalFlip);
 }
 
 void GpuTextureSpec::verticalFlip()
@@ -54,9 +55,33 @@ void GpuTextureSpec::verticalFlip()
     }
 }
 
+bool GpuTextureSpec::compressed() const
+{
+    switch ((CompressedFormat)internalFormat)
+    {
+    case CompressedFormat::Bc1Rgb:
+    case CompressedFormat::Bc3Rgba:
+    case CompressedFormat::Etc2Rgb:
+    case CompressedFormat::Etc2Rgba:
+        return true;
+    default:
+        return false;
+    }
+}
+
 uint32 GpuTextureSpec::expectedSize() const
 {
-    return width * height * components * gpuTypeSize(type);
+    switch ((CompressedFormat)internalFormat)
+    {
+    case CompressedFormat::Bc1Rgb:
+    case CompressedFormat::Etc2Rgb:
+        return ((width + 3) / 4) * ((height + 3) / 4) * 8;
+    case CompressedFormat::Bc3Rgba:
+    case CompressedFormat::Etc2Rgba:
+        return ((width + 3) / 4) * ((height + 3) / 4) * 16;
+    default:
+        return width * height * components * gpuTypeSize(type);
+    }
 }
 
 Buffer GpuTextureSpec::encodePng() const
@@ -71,6 +96,99 @@ Buffer GpuTextureSpec::encodePng() const
     return out;
 }
 
+namespace
+{
+
+bool mipmapped(GpuTextureSpec::FilterMode filterMode)
+{
+    switch (filterMode)
+    {
+    case GpuTextureSpec::FilterMode::Nearest:
+    case GpuTextureSpec::FilterMode::Linear:
+        return false;
+    default:
+        return true;
+    }
+}
+
+bool opaque(const GpuTextureSpec &spec)
+{
+    if (spec.components != 4)
+        return true;
+    const uint8 *p = (const uint8 *)spec.buffer.data();
+    const uint8 *e = (const uint8 *)spec.buffer.dataEnd();
+    for (p += 3; p < e; p += 4)
+        if (*p != 255)
+            return false;
+    return true;
+}
+
+void compressTexture(GpuTextureSpec &spec, TextureCompression compression)
+{
+    if (compression == TextureCompression::None
+        || spec.type != GpuTypeEnum::UnsignedByte
+        || (spec.components != 3 && spec.components != 4))
+        return;
+    const bool alpha = !opaque(spec);
+    void (*compress)(const Buffer &, Buffer &, uint32, uint32, uint32)
+        = nullptr;
+    GpuTextureSpec::CompressedFormat format
+        = GpuTextureSpec::CompressedFormat::Bc1Rgb;
+    switch (compression)
+    {
+    case TextureCompression::Bc:
+        compress = alpha ? &compressBc3 : &compressBc1;
+        format = alpha ? GpuTextureSpec::CompressedFormat::Bc3Rgba
+            : GpuTextureSpec::CompressedFormat::Bc1Rgb;
+        break;
+    case TextureCompression::Etc2:
+        compress = alpha ? &compressEtc2Rgba : &compressEtc2Rgb;
+        format = alpha ? GpuTextureSpec::CompressedFormat::Etc2Rgba
+            : GpuTextureSpec::CompressedFormat::Etc2Rgb;
+        break;
+    default:
+        LOGTHROW(err2, std::invalid_argument)
+            << "Invalid texture compression";
+    }
+    {
+        Buffer out;
+        compress(spec.buffer, out, spec.width, spec.height, spec.components);
+        spec.buffer = std::move(out);
+    }
+    uint32 w = spec.width, h = spec.height;
+    for (Buffer &level : spec.mipmaps)
+    {
+        w = std::max(w / 2, 1u);
+        h = std::max(h / 2, 1u);
+        Buffer out;
+        compress(level, out, w, h, spec.components);
+        level = std::move(out);
+    }
+    spec.internalFormat = (uint32)format;
+    if (!alpha)
+        spec.components = 3;
+    assert(spec.buffer.size() == spec.expectedSize());
+    if (!spec.mipmaps.empty())
+        return;
+
+    // the gpu cannot generate mipmaps for compressed textures
+    switch (spec.filterMode)
+    {
+    case GpuTextureSpec::FilterMode::NearestMipmapNearest:
+    case GpuTextureSpec::FilterMode::NearestMipmapLinear:
+        spec.filterMode = GpuTextureSpec::FilterMode::Nearest;
+        break;
+    case GpuTextureSpec::FilterMode::LinearMipmapNearest:
+    case GpuTextureSpec::FilterMode::LinearMipmapLinear:
+        spec.filterMode = GpuTextureSpec::FilterMode::Linear;
+        break;
+    default:
+        break;
+    }
+}
+
+} // namespace
+
 GpuTexture::GpuTexture(MapImpl *map, const std::string &name) :
     Resource(map, name)
 {}
@@ -78,8 +196,9 @@ GpuTexture::GpuTexture(MapImpl *map, const std::string &name) :
 void GpuTexture::decode()
 {
     LOG(info1) << "Decoding texture <" << name << ">";
+    // the rows are decoded bottom-up, as expected by the gpu
     std::shared_ptr<GpuTextureSpec> spec
-        = std::make_shared<GpuTextureSpec>(fetch->reply.content);
+        = std::make_shared<GpuTextureSpec>(fetch->reply.content, true);
     this->width = spec->width;
     this->height = spec->height;
     spec->filterMode = filterMode;
@@ -96,15 +215,24 @@ void GpuTexture::decode()
         if (!boost::filesystem::exists(path))
         {
             boost::filesystem::create_directories(prefix + b);
-            Buffer out;
-            encodePng(spec->buffer, out,
-                spec->width, spec->height, spec->components);
-            writeLocalFileBuffer(path, out);
+            GpuTextureSpec tmp;
+            tmp.width = spec->width;
+            tmp.height = spec->height;
+            tmp.components = spec->components;
+            tmp.buffer = spec->buffer.copy();
+            tmp.verticalFlip();
+            writeLocalFileBuffer(path, tmp.encodePng());
         }
     }
 #endif
 
-    spec->verticalFlip();
+    if (map->options.textureMipmapsOnDecode && mipmapped(spec->filterMode)
+        && spec->type == GpuTypeEnum::UnsignedByte)
+    {
+        generateMipmaps(spec->buffer, spec->mipmaps,
+            spec->width, spec->height, spec->components);
+    }
+    compressTexture(*spec, compression);
     decodeData = std::static_pointer_cast<void>(spec);
 }
 
@@ -0,0 +1,119 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SEEDINGTASK_HPP_e8f7g6h5
+#define SEEDINGTASK_HPP_e8f7g6h5
+
+#include <deque>
+#include <unordered_set>
+#include <thread>
+
+#include "include/vts-browser/seeding.hpp"
+#include "include/vts-browser/fetcher.hpp"
+
+#include "metaTile.hpp"
+#include "utilities/threadQueue.hpp"
+
+namespace vts
+{
+
+class Cache;
+
+class SeedingFetchTask : public FetchTask
+{
+public:
+    SeedingFetchTask(const std::string &name, ResourceType resourceType);
+    void fetchDone() override;
+
+    const std::string name;
+    std::shared_ptr<void> availTest; // vtslibs::registry::BoundLayer::Availability
+    uint32 redirectionsCount = 0;
+    // the reply is processed by the main thread once this is set
+    std::atomic<bool> finished {false};
+};
+
+class SeedingTaskImpl
+{
+public:
+    struct Node
+    {
+        std::shared_ptr<MapLayer> layer;
+        TileId id;
+        std::vector<std::shared_ptr<MetaTile>> parentMetaTiles;
+    };
+
+    struct Bound
+    {
+        std::string boundId;
+        TileId id;
+        TileId localId;
+    };
+
+    struct Download
+    {
+        std::string name;
+        FetchTask::ResourceType type;
+        std::shared_ptr<void> availTest; // same as in FetchTaskImpl
+        bool cached = false; // set by the cache checker thread
+    };
+
+    SeedingTaskImpl(MapImpl *map, const std::shared_ptr<SeedingTask> &task);
+    ~SeedingTaskImpl();
+
+    void cacheCheckEntry();
+    void terminate();
+
+    std::weak_ptr<SeedingTask> task;
+    const SeedingOptions options;
+    // the tiles are traversed depth first to keep the nodes
+    //   (and the metatiles they hold) few
+    std::vector<Node> nodes; // stack
+    std::deque<Node> waiting; // for metatiles, retried in next update
+    std::deque<Bound> bounds;
+    std::deque<Download> downloads; // not yet checked in the cache
+    std::deque<Download> missing; // not in the cache, waiting for download
+    std::vector<std::shared_ptr<SeedingFetchTask>> active;
+    std::unordered_set<std::string> boundsQueued; // coarser lods only
+
+    // metatiles that the pending nodes wait for
+    //   they are touched every update to keep them loading
+    std::unordered_set<std::shared_ptr<Resource>> awaited;
+
+    // the disk cache is queried on a separate thread
+    std::shared_ptr<Cache> cache;
+    ThreadQueue<Download> queCacheCheck;
+    ThreadQueue<Download> queCacheChecked;
+    uint32 cacheChecking = 0; // main thread only
+    std::thread thrCacheCheck;
+
+    // the seeding extents converted into srs of each division node
+    //   none if the overlap cannot be decided
+    std::vector<boost::optional<Extents2>> divisionExtents;
+};
+
+} // namespace vts
+
+#endif
@@ -0,0 +1,98 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SHARED_CONTEXT_HPP_wefg4j5k
+#define SHARED_CONTEXT_HPP_wefg4j5k
+
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+
+#include "include/vts-browser/mapSharedContext.hpp"
+#include "include/vts-browser/mapOptions.hpp"
+
+#include "map.hpp"
+
+namespace vts
+{
+
+class DecodeJob
+{
+public:
+    DecodeJob() = default;
+    explicit DecodeJob(const std::shared_ptr<Resource> &resource);
+
+    std::weak_ptr<Resource> resource;
+    uint64 mapId = 0;
+};
+
+class MapSharedContextImpl : public MapSharedContext
+{
+public:
+    MapSharedContextImpl(const MapCreateOptions &options,
+        const std::shared_ptr<Fetcher> &fetcher);
+    ~MapSharedContextImpl();
+
+    void attach(MapImpl *map);
+    void detach(MapImpl *map); // waits for workers processing the map
+
+    // keeps the map attached while its resource is processed
+    //   returns null once the map is being detached
+    // maps are identified by ids, since a new map may reuse
+    //   the address of a destroyed one while its jobs are still queued
+    MapImpl *acquire(uint64 mapId);
+    void release(uint64 mapId);
+
+    void decodeEntry();
+    void cacheInit();
+    void cacheWriteEntry();
+    void cacheWrite(CacheData &&data);
+
+    const MapCreateOptions createOptions;
+    std::shared_ptr<Fetcher> fetcher; // merges concurrent downloads
+    std::shared_ptr<Cache> cache;
+
+    ResourceQueue<DecodeJob> queDecode;
+    ThreadQueue<CacheData> queCacheWrite;
+    std::vector<std::thread> thrDecoders;
+    std::thread thrCacheWriter;
+
+private:
+    struct MapUsers
+    {
+        MapImpl *map = nullptr;
+        uint32 active = 0; // number of resources being processed
+        bool detaching = false;
+    };
+
+    std::unordered_map<uint64, MapUsers> maps;
+    std::mutex mapsMutex;
+    std::condition_variable mapsCondition;
+};
+
+} // namespace vts
+
+#endif
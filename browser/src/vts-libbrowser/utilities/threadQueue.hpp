@@ -28,10 +28,13 @@
 #define THREAD_QUEUE_gdf5g4d56f4ghd6h4
 
 #include <vector>
+#include <deque>
+#include <unordered_map>
 #include <atomic>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <cmath>
 
 namespace vts
 {
@@ -47,6 +50,8 @@ public:
             if (stop)
                 return;
             q.push_back(v);
+            if (waiting == 0)
+                return;
         }
         con.notify_one();
     }
@@ -58,6 +63,8 @@ public:
             if (stop)
                 return;
             q.push_back(std::move(v));
+            if (waiting == 0)
+                return;
         }
         con.notify_one();
     }
@@ -68,7 +75,7 @@ public:
         if (q.empty() || stop)
             return false;
         v = std::move(q.front());
-        q.erase(q.begin());
+        q.pop_front();
         return true;
     }
 
@@ -76,36 +83,179 @@ public:
     {
         std::unique_lock<std::mutex> lock(mut);
         while (q.empty() && !stop)
+        {
+            waiting++;
             con.wait(lock);
+            waiting--;
+        }
         if (q.empty() || stop)
             return false;
         v = std::move(q.front());
-        q.erase(q.begin());
+        q.pop_front();
+        return true;
+    }
+
+    void terminate()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            stop = true;
+        }
+        con.notify_all();
+    }
+
+    void purge()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            stop = true;
+            q.clear();
+        }
+        con.notify_all();
+    }
+
+    bool stopped() const
+    {
+        return stop;
+    }
+
+    uint32 estimateSize() const
+    {
+        return q.size();
+    }
+
+private:
+    std::atomic<bool> stop {false};
+    std::deque<T> q;
+    uint32 waiting = 0;
+    mutable std::mutex mut;
+    std::condition_variable con;
+};
+
+// pops items with highest priority first (fifo among equal priorities)
+// items pushed with a key may have their priority raised
+//   while they wait in the queue
+template<class T, class K = const void *>
+class ThreadQueuePriority
+{
+public:
+    void push(T &&v, float priority, K key = K())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            if (stop)
+                return;
+            insert(std::move(v), priority, key);
+            if (waiting == 0)
+                return;
+        }
+        con.notify_one();
+    }
+
+    // returns false if there is no item with the key in the queue
+    bool updatePriority(K key, float priority)
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        auto it = index.find(key);
+        if (it == index.end())
+            return false;
+        std::size_t pos = it->second;
+        priority = sanitize(priority);
+        if (priority > heap[pos].priority)
+        {
+            heap[pos].priority = priority;
+            siftUp(pos);
+        }
+        return true;
+    }
+
+    bool tryPop(T &v)
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        if (heap.empty() || stop)
+            return false;
+        extract(v);
+        return true;
+    }
+
+    // pops the top item only if the predicate accepts it
+    // the predicate is evaluated with the queue locked
+    template<class F>
+    bool tryPop(T &v, F accept)
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        if (heap.empty() || stop || !accept((const T &)heap[0].value))
+            return false;
+        extract(v);
         return true;
     }
 
-    std::vector<T> readAllWait()
+    bool waitPop(T &v)
     {
         std::unique_lock<std::mutex> lock(mut);
+        while (heap.empty() && !stop)
+        {
+            waiting++;
+            con.wait(lock);
+            waiting--;
+        }
+        if (heap.empty() || stop)
+            return false;
+        extract(v);
+        return true;
+    }
+
+    // waits until there is an item and the predicate allows taking it
+    // the predicate is evaluated with the queue locked
+    //   and notify must be called after any change that affects it
+    template<class F>
+    bool waitPop(T &v, F ready)
+    {
+        std::unique_lock<std::mutex> lock(mut);
+        while (!stop && (heap.empty() || !ready()))
+        {
+            waiting++;
+            con.wait(lock);
+            waiting--;
+        }
         if (stop)
-            return {};
-        con.wait(lock);
-        if (stop)
-            return {};
-        std::vector<T> res;
-        res.swap(q);
-        return res;
+            return false;
+        extract(v);
+        return true;
     }
 
-    void writeAll(std::vector<T> &writing)
+    // wakes up the waiting threads to evaluate their predicates again
+    void notify()
     {
         {
-            std::unique_lock<std::mutex> lock(mut);
+            std::lock_guard<std::mutex> lock(mut);
+            if (waiting == 0)
+                return;
+        }
+        con.notify_all();
+    }
+
+    // replaces whole content of the queue
+    void writeAll(std::vector<std::pair<float, T>> &writing)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mut);
             if (stop)
                 return;
-            writing.swap(q);
+            heap.clear();
+            index.clear();
+            heap.reserve(writing.size());
+            for (auto &it : writing)
+                heap.push_back(Item(std::move(it.second),
+                    sanitize(it.first), order++, K()));
+            writing.clear();
+            for (std::size_t i = heap.size() / 2; i-- > 0;)
+                siftDown(i);
+            if (waiting == 0 || heap.empty())
+                return;
         }
-        con.notify_one();
+        // all items arrive at once, wake up all consumers
+        con.notify_all();
     }
 
     void terminate()
@@ -122,7 +272,8 @@ public:
         {
             std::lock_guard<std::mutex> lock(mut);
             stop = true;
-            q.clear();
+            heap.clear();
+            index.clear();
         }
         con.notify_all();
     }
@@ -134,12 +285,110 @@ public:
 
     uint32 estimateSize() const
     {
-        return q.size();
+        return heap.size();
     }
 
 private:
+    struct Item
+    {
+        T value;
+        float priority;
+        uint64 order;
+        K key;
+
+        Item(T &&value, float priority, uint64 order, K key) :
+            value(std::move(value)), priority(priority),
+            order(order), key(key)
+        {}
+    };
+
+    static float sanitize(float priority)
+    {
+        return std::isnan(priority) ? 0 : priority;
+    }
+
+    static bool before(const Item &a, const Item &b)
+    {
+        if (a.priority != b.priority)
+            return a.priority > b.priority;
+        return a.order < b.order;
+    }
+
+    void reindex(std::size_t pos)
+    {
+        if (heap[pos].key != K())
+            index[heap[pos].key] = pos;
+    }
+
+    void siftUp(std::size_t pos)
+    {
+        while (pos > 0)
+        {
+            std::size_t parent = (pos - 1) / 2;
+            if (!before(heap[pos], heap[parent]))
+                break;
+            std::swap(heap[pos], heap[parent]);
+            reindex(pos);
+            reindex(parent);
+            pos = parent;
+        }
+    }
+
+    void siftDown(std::size_t pos)
+    {
+        while (true)
+        {
+            std::size_t best = pos;
+            std::size_t l = pos * 2 + 1;
+            std::size_t r = l + 1;
+            if (l < heap.size() && before(heap[l], heap[best]))
+                best = l;
+            if (r < heap.size() && before(heap[r], heap[best]))
+                best = r;
+            if (best == pos)
+                break;
+            std::swap(heap[pos], heap[best]);
+            reindex(pos);
+            reindex(best);
+            pos = best;
+        }
+    }
+
+    void insert(T &&v, float priority, K key)
+    {
+        if (key != K())
+        {
+            // a key may belong to a single item only
+            auto it = index.find(key);
+            if (it != index.end())
+                heap[it->second].key = K();
+        }
+        heap.push_back(Item(std::move(v), sanitize(priority), order++, key));
+        reindex(heap.size() - 1);
+        siftUp(heap.size() - 1);
+    }
+
+    void extract(T &v)
+    {
+        if (heap.front().key != K())
+            index.erase(heap.front().key);
+        v = std::move(heap.front().value);
+        if (heap.size() > 1)
+        {
+            heap.front() = std::move(heap.back());
+            heap.pop_back();
+            reindex(0);
+            siftDown(0);
+        }
+        else
+            heap.pop_back();
+    }
+
     std::atomic<bool> stop {false};
-    std::vector<T> q;
+    std::vector<Item> heap;
+    std::unordered_map<K, std::size_t> index;
+    uint64 order = 0;
+    uint32 waiting = 0;
     mutable std::mutex mut;
     std::condition_variable con;
 };
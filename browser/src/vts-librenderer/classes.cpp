@@ -27,6 +27,7 @@
 #include "renderer.hpp"
 
 #include <thread>
+#include <algorithm>
 
 #include <optick.h>
 
@@ -448,16 +449,35 @@ bool gpuTypeInteger(GpuTypeEnum type)
 void Texture::load(ResourceInfo &info, vts::GpuTextureSpec &spec,
     const std::string &debugId)
 {
-    assert(spec.buffer.size() == spec.width * spec.height
-           * spec.components * gpuTypeSize(spec.type)
+    assert(spec.buffer.size() == spec.expectedSize()
            || spec.buffer.size() == 0);
 
     clear();
     glGenTextures(1, &id);
     glBindTexture(GL_TEXTURE_2D, id);
-    glTexImage2D(GL_TEXTURE_2D, 0, findInternalFormat(spec),
-                 spec.width, spec.height, 0,
-                 findFormat(spec), (GLenum)spec.type, spec.buffer.data());
+    uint32 w = spec.width, h = spec.height;
+    for (uint32 level = 0; level <= spec.mipmaps.size(); level++)
+    {
+        const Buffer &b = level ? spec.mipmaps[level - 1] : spec.buffer;
+        if (spec.compressed())
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, spec.internalFormat,
+                     w, h, 0, b.size(), b.data());
+        }
+        else
+        {
+            glTexImage2D(GL_TEXTURE_2D, level, findInternalFormat(spec),
+                     w, h, 0, findFormat(spec), (GLenum)spec.type, b.data());
+        }
+        info.gpuMemoryCost += b.size();
+        w = std::max(w / 2, 1u);
+        h = std::max(h / 2, 1u);
+    }
+    if (!spec.mipmaps.empty())
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+            spec.mipmaps.size());
+    }
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
         (GLenum)spec.filterMode);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,
@@ -480,7 +500,12 @@ void Texture::load(ResourceInfo &info, vts::GpuTextureSpec &spec,
     case GpuTextureSpec::FilterMode::Linear:
         break;
     default:
-        glGenerateMipmap(GL_TEXTURE_2D);
+        // the mipmaps may have been prepared by the library already
+        if (spec.mipmaps.empty())
+        {
+            glGenerateMipmap(GL_TEXTURE_2D);
+            info.gpuMemoryCost += spec.buffer.size() / 3;
+        }
         break;
     }
 
@@ -488,7 +513,6 @@ void Texture::load(ResourceInfo &info, vts::GpuTextureSpec &spec,
     setDebugId(debugId);
     CHECK_GL("load texture");
     info.ramMemoryCost += sizeof(*this);
-    info.gpuMemoryCost += spec.buffer.size();
 }
 
 void Texture::setId(uint32 id)
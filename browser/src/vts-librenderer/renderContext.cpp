@@ -52,8 +52,7 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
     {
         texCompas = std::make_shared<Texture>();
         GpuTextureSpec spec(vts::readInternalMemoryBuffer(
-            "data/textures/compas.png"));
-        spec.verticalFlip();
+            "data/textures/compas.png"), true);
         ResourceInfo ri;
         texCompas->load(ri, spec, "data/textures/compas.png");
     }
@@ -67,13 +66,13 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
         {
             std::stringstream ss;
             ss << "data/textures/blueNoise/" << i << ".png";
-            GpuTextureSpec spec(vts::readInternalMemoryBuffer(ss.str()));
+            GpuTextureSpec spec(vts::readInternalMemoryBuffer(ss.str()),
+                true);
             assert(spec.width == 64);
             assert(spec.height == 64);
             assert(spec.components == 1);
             assert(spec.type == GpuTypeEnum::UnsignedByte);
             assert(spec.buffer.size() == 64 * 64);
-            spec.verticalFlip();
             memcpy(buff.data() + (64 * 64 * i), spec.buffer.data(), 64 * 64);
         }
         glActiveTexture(GL_TEXTURE0 + 9);